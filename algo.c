@@ -1,260 +1,3462 @@
+#define _DEFAULT_SOURCE
 #include "algo.h"
+#include "blocks.h"
+#include "hierarchy.h"
 
+#include <errno.h>
+#include <fcntl.h>
 #include <limits.h>
+#include <math.h>
+#include <pthread.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+/*
+ * The edge section is split into chunks of at least BOARD_PARSE_CHUNK
+ * bytes, parsed on at most BOARD_PARSE_THREADS threads
+ */
+#define BOARD_PARSE_CHUNK (1 << 20)
+#define BOARD_PARSE_THREADS 16
+
+/*
+ * Breadth-first searches of board_BFS_all_pairs run on at most this
+ * many threads
+ */
+#define BOARD_APSP_THREADS 16
+
+/*
+ * Sources searched at once by board_MS_BFS_all_pairs, one bit each in
+ * BOARD_MSBFS_LANES / 64 words per vertex that the compiler can
+ * process as vectors
+ */
+#define BOARD_MSBFS_LANES 256
+
+/*
+ * Floyd-Warshall works on square tiles of BOARD_FW_TILE x BOARD_FW_TILE
+ * distances (16 KB), and BOARD_FW_INF + BOARD_FW_INF fits an int32_t
+ */
+#define BOARD_FW_TILE 64
+#define BOARD_FW_INF 0x3fffffff
+
+/*
+ * Distance tables of at least this size (a huge page) are aligned on it
+ * and advised for transparent huge pages
+ */
+#define BOARD_DIST_HUGE (2 << 20)
+
+/*
+ * Tables saved in dist_cache_dir or published in shared memory: a
+ * 64-byte header, then dist and, if it was stored, next, each starting
+ * on a 64-byte boundary. The version changes whenever the tables a
+ * graph gets would change. ready and refs are only used in shared
+ * memory, where ready becomes 1 once the tables are complete and refs
+ * counts the processes attached; once it has fallen to 0 it never rises
+ * again.
+ */
+#define BOARD_TABLES_MAGIC "CRDT"
+#define BOARD_TABLES_VERSION 1
+
+typedef struct
+{
+  char magic[4];
+  uint32_t version;
+  uint64_t hash;
+  uint64_t size;
+  uint64_t nadj;
+  uint32_t dist_width;
+  uint32_t next_width;
+  uint64_t dist_bytes;
+  uint64_t next_bytes;
+  uint32_t ready;
+  uint32_t refs;
+} board_tables_header;
+
+/*
+ * Shared memory segments are named after the hash of the graph, with a
+ * suffix when they hold no next. Processes finding a segment wait at
+ * most BOARD_SHM_WAIT_MS for the process building it, then compute
+ * their own tables.
+ */
+#define BOARD_SHM_PREFIX "/crdt-"
+#define BOARD_SHM_WAIT_MS 60000
 
 void board_create (board *self)
 {
   if (!self)
     return;
   self->size = 0;
-  self->vertices = NULL;
+  self->offsets = NULL;
+  self->adj = NULL;
+  self->weights = NULL;
+  self->adj_bits = NULL;
+  self->adj_sorted = NULL;
+  self->adj_indexed = false;
+  self->simplify = false;
+  self->weighted = false;
+  self->removed_edges = 0;
+  self->map = NULL;
+  self->map_len = 0;
+  self->order = NULL;
+  self->rank = NULL;
+  self->apsp = BOARD_APSP_BFS;
+  self->x = NULL;
+  self->y = NULL;
+  self->max_edge = 0;
   self->cops = 0;
   self->robbers = 0;
   self->max_turn = 0;
+  self->ncomps = 0;
+  self->comp = NULL;
+  self->comp_pos = NULL;
+  self->comp_start = NULL;
+  self->comp_members = NULL;
+  self->comp_block = NULL;
+  self->dist_block = NULL;
   self->dist = NULL;
+  self->dist_width = 0;
   self->next = NULL;
+  self->next_width = 0;
+  self->dist_cache_bytes = 0;
+  self->row_cache = NULL;
+  self->landmark_count = 0;
+  self->landmarks = NULL;
+  self->contract = false;
+  self->hierarchy_file = NULL;
+  self->hierarchy = NULL;
+  self->blocks = false;
+  self->block_tree = NULL;
+  self->dist_cache_dir = NULL;
+  self->tables_map = NULL;
+  self->tables_map_len = 0;
+  self->share_tables = false;
+  self->tables_shared = NULL;
 }
 
 /*
- * Auxiliary function to factorize code
+ * Number of threads worth starting for a task allowing at most max
  */
-void board_add_edge_uni (board_vertex *source, board_vertex *destination)
+static size_t thread_count (size_t max)
 {
-  if (!source || !destination)
-    return;
-  source->degree++;
-  source->neighbors = realloc (source->neighbors,
-                               source->degree *
-                               sizeof (*(source->neighbors)));
-  source->neighbors[source->degree - 1] = destination;
+  long cpus = sysconf (_SC_NPROCESSORS_ONLN);
+  if (cpus < 1)
+    cpus = 1;
+  return (size_t) cpus < max ? (size_t) cpus : max;
 }
 
-bool board_read_from (board *self, FILE *file)
+static int compare_uint32 (const void *a, const void *b)
 {
-  if (!self || !file)
-    return false;
-  char line[128];
+  uint32_t x = *(const uint32_t *) a, y = *(const uint32_t *) b;
+  return (x > y) - (x < y);
+}
+
+static int compare_uint64 (const void *a, const void *b)
+{
+  uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+  return (x > y) - (x < y);
+}
 
-  if (!fgets (line, sizeof (line), file))
+/*
+ * Length of the i-th edge of u
+ */
+static inline uint32_t edge_length (const board *self, size_t u, size_t i)
+{
+  return self->weights ? self->weights[self->offsets[u] + i] : 1;
+}
+
+static size_t board_max_degree (const board *self)
+{
+  size_t max = 0;
+  for (size_t v = 0; v < self->size; v++)
+    max = board_degree (self, v) > max ? board_degree (self, v) : max;
+  return max;
+}
+
+/*
+ * Build the CSR adjacency from a buffered list of nedges pairs, and
+ * their weights if not NULL: a first pass counts the degrees, a second
+ * one scatters the neighbors
+ */
+static bool board_build_adjacency (board *self, const uint32_t *edges,
+                                   const uint32_t *weights, size_t nedges)
+{
+  // Une arête (v1, v2) donne au plus deux entrées dans adj
+  self->offsets = calloc (self->size + 1 + 2 * nedges,
+                          sizeof (*self->offsets));
+  if (!self->offsets)
     return false;
-  char extra;
-  if (sscanf (line, "Cops: %zu %c", &(self->cops), &extra) != 1 ||
-      self->cops == 0)
+  self->adj = self->offsets + self->size + 1;
+  if (weights)
     {
-      return false;
-    };
+      self->weights = malloc ((nedges ? 2 * nedges : 1)
+                              * sizeof (*self->weights));
+      if (!self->weights)
+        return false;
+    }
 
-  if (!fgets (line, sizeof (line), file))
-    return false;
-  if (sscanf (line, "Robbers: %zu %c", &(self->robbers), &extra) != 1 ||
-      self->robbers == 0)
+  self->removed_edges = 0;
+  for (size_t i = 0; i < nedges; i++)
     {
-      return false;
-    };
+      uint32_t v1 = edges[2 * i], v2 = edges[2 * i + 1];
+      if (v1 == v2 && self->simplify)
+        {
+          // Rester sur place est toujours autorisé
+          self->removed_edges++;
+          continue;
+        }
+      self->offsets[v1 + 1]++;
+      if (v1 != v2)
+        self->offsets[v2 + 1]++;
+    }
+  for (size_t v = 0; v < self->size; v++)
+    self->offsets[v + 1] += self->offsets[v];
 
-  if (!fgets (line, sizeof (line), file))
+  // Remplissage dans l'ordre du fichier, fill[v] = prochaine case libre
+  uint32_t *fill = malloc (self->size * sizeof (*fill));
+  if (!fill)
     return false;
-  if (sscanf (line, "Max turn: %zu %c", &(self->max_turn), &extra) != 1 ||
-      self->max_turn == 0)
+  for (size_t v = 0; v < self->size; v++)
+    fill[v] = self->offsets[v];
+  for (size_t i = 0; i < nedges; i++)
     {
-      return false;
+      uint32_t v1 = edges[2 * i], v2 = edges[2 * i + 1];
+      if (v1 == v2 && self->simplify)
+        continue;
+      if (weights)
+        self->weights[fill[v1]] = weights[i];
+      self->adj[fill[v1]++] = v2;
+      if (v1 != v2)
+        {
+          if (weights)
+            self->weights[fill[v2]] = weights[i];
+          self->adj[fill[v2]++] = v1;
+        }
     }
+  free (fill);
 
-  if (!fgets (line, sizeof (line), file))
-    return false;
-  if (sscanf (line, "Vertices: %zu %c", &(self->size), &extra) != 1 ||
-      self->size == 0)
+  if (self->simplify)
     {
-      return false;
-    };
+      // seen[w] = v + 1 quand w est déjà dans la ligne de v, en at[w]
+      uint32_t *seen = calloc (2 * self->size, sizeof (*seen));
+      if (!seen)
+        return false;
+      uint32_t *at = seen + self->size;
+      // Compactage dans l'ordre du fichier : chaque voisin garde sa
+      // première place et la plus courte de ses arêtes
+      size_t out = 0, duplicates = 0;
+      for (size_t v = 0; v < self->size; v++)
+        {
+          uint32_t begin = self->offsets[v], end = self->offsets[v + 1];
+          self->offsets[v] = out;
+          for (uint32_t i = begin; i < end; i++)
+            {
+              uint32_t w = self->adj[i];
+              if (seen[w] == v + 1)
+                {
+                  duplicates++;
+                  if (weights && self->weights[i] < self->weights[at[w]])
+                    self->weights[at[w]] = self->weights[i];
+                  continue;
+                }
+              seen[w] = v + 1;
+              at[w] = out;
+              if (weights)
+                self->weights[out] = self->weights[i];
+              self->adj[out++] = w;
+            }
+        }
+      free (seen);
+      self->offsets[self->size] = out;
+      // Chaque doublon apparaît dans la ligne de ses deux extrémités
+      self->removed_edges += duplicates / 2;
+    }
+  return true;
+}
 
-  self->vertices = calloc (self->size, sizeof (*self->vertices));
-  if (!self->vertices)
-    return false;
+/*
+ * Minimal scanner over an in-memory map file. Every helper works on
+ * [p, end) and returns the position after what it consumed, or NULL if
+ * the expected token is absent. The rules follow the sscanf formats the
+ * loader used to rely on: a space in a literal matches any run of
+ * whitespace and integers accept an optional sign.
+ */
+static bool is_space (char c)
+{
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v'
+    || c == '\f';
+}
 
-  for (size_t i = 0; i < self->size; i++)
+static const char *skip_space (const char *p, const char *end)
+{
+  while (p < end && is_space (*p))
+    p++;
+  return p;
+}
+
+static const char *scan_literal (const char *p, const char *end,
+                                 const char *literal)
+{
+  for (; *literal; literal++)
     {
-      self->vertices[i] = calloc (1, sizeof (**self->vertices));
-      if (!self->vertices[i])
-        return false;
-      self->vertices[i]->index = i;
-      self->vertices[i]->degree = 0;
-      self->vertices[i]->neighbors = NULL;
+      if (*literal == ' ')
+        p = skip_space (p, end);
+      else if (p < end && *p == *literal)
+        p++;
+      else
+        return NULL;
+    }
+  return p;
+}
 
-      if (!fgets (line, sizeof (line), file))
-        return false;
+static const char *scan_size (const char *p, const char *end, size_t *out)
+{
+  p = skip_space (p, end);
+  bool negative = false;
+  if (p < end && (*p == '+' || *p == '-'))
+    negative = *p++ == '-';
+  if (p == end || *p < '0' || *p > '9')
+    return NULL;
+  size_t value = 0;
+  for (; p < end && *p >= '0' && *p <= '9'; p++)
+    {
+      size_t digit = *p - '0';
+      value = value > (SIZE_MAX - digit) / 10 ? SIZE_MAX : value * 10 + digit;
     }
+  *out = negative ? -value : value;
+  return p;
+}
 
-  size_t edges = 0;
-  if (!fgets (line, sizeof (line), file))
-    return false;
-  if (sscanf (line, "Edges: %zu %c", &edges, &extra) != 1)
+/*
+ * Decimal number with optional sign, fraction and exponent, like
+ * strtod but on data that is not nul-terminated
+ */
+static const char *scan_float (const char *p, const char *end, float *out)
+{
+  p = skip_space (p, end);
+  bool negative = false;
+  if (p < end && (*p == '+' || *p == '-'))
+    negative = *p++ == '-';
+  double mantissa = 0;
+  long scale = 0;
+  bool digits = false;
+  for (; p < end && *p >= '0' && *p <= '9'; p++, digits = true)
+    mantissa = mantissa * 10 + (*p - '0');
+  if (p < end && *p == '.')
+    for (p++; p < end && *p >= '0' && *p <= '9'; p++, digits = true)
+      {
+        mantissa = mantissa * 10 + (*p - '0');
+        scale--;
+      }
+  if (!digits)
+    return NULL;
+  if (p < end && (*p == 'e' || *p == 'E'))
     {
-      return false;
+      const char *q = p + 1;
+      bool negative_exponent = false;
+      if (q < end && (*q == '+' || *q == '-'))
+        negative_exponent = *q++ == '-';
+      if (q < end && *q >= '0' && *q <= '9')
+        {
+          long exponent = 0;
+          for (; q < end && *q >= '0' && *q <= '9'; q++)
+            exponent = exponent < 1000 ? exponent * 10 + (*q - '0') : 1000;
+          scale += negative_exponent ? -exponent : exponent;
+          p = q;
+        }
     }
+  // Au-delà, le résultat est de toute façon nul ou infini en float
+  double power = 1;
+  for (long i = 0; i < labs (scale) && i < 400; i++)
+    power *= 10;
+  double value = scale < 0 ? mantissa / power : mantissa * power;
+  *out = negative ? -value : value;
+  return p;
+}
 
-  for (size_t i = 0; i < edges; i++)
+/*
+ * Return the start of the line after the one beginning at p and set
+ * *line_end to its end (newline excluded), or NULL at end of data
+ */
+static const char *next_line (const char *p, const char *end,
+                              const char **line_end)
+{
+  if (p >= end)
+    return NULL;
+  const char *nl = memchr (p, '\n', end - p);
+  *line_end = nl ? nl : end;
+  return nl ? nl + 1 : end;
+}
+
+/*
+ * Parse a "<literal> <value>" header line with nothing else on it
+ */
+static const char *scan_header (const char *p, const char *end,
+                                const char *literal, size_t *out)
+{
+  const char *line_end;
+  const char *next = next_line (p, end, &line_end);
+  if (!next)
+    return NULL;
+  p = scan_literal (p, line_end, literal);
+  if (!p)
+    return NULL;
+  p = scan_size (p, line_end, out);
+  if (!p || skip_space (p, line_end) != line_end)
+    return NULL;
+  return next;
+}
+
+typedef struct
+{
+  const char *begin;
+  const char *end;
+  size_t first;
+  size_t lines;
+  size_t size;
+  uint32_t *list;
+  const float *coords;
+  uint32_t *weights;
+  bool ok;
+} edge_chunk;
+
+/*
+ * Weight of an edge of the given length, rounded but at least 1, or 0
+ * if it does not fit in BOARD_WEIGHT_MAX
+ */
+static uint32_t edge_weight (double length)
+{
+  double weight = length * BOARD_WEIGHT_SCALE + 0.5;
+  if (!(weight <= BOARD_WEIGHT_MAX))
+    return 0;
+  return weight >= 1 ? (uint32_t) weight : 1;
+}
+
+/*
+ * Parse every "v1 v2" line of a chunk into list, starting at pair
+ * number first. With weights, a third number is the length of the
+ * edge, otherwise taken from coords if not NULL (the size x then the
+ * size y); anything else on the line is ignored.
+ */
+static void *parse_edge_chunk (void *arg)
+{
+  edge_chunk *chunk = arg;
+  const char *p = chunk->begin, *line_end;
+  uint32_t *out = chunk->list + 2 * chunk->first;
+  uint32_t *weight = chunk->weights ? chunk->weights + chunk->first : NULL;
+  chunk->ok = true;
+  for (const char *next; (next = next_line (p, chunk->end, &line_end));
+       p = next)
     {
       size_t v1, v2;
-      if (!fgets (line, sizeof (line), file))
-        return false;
-      if (sscanf (line, "%zu %zu", &v1, &v2) != 2 || v1 >= self->size ||
-          v2 >= self->size)
+      const char *q = scan_size (p, line_end, &v1);
+      if (!q || !(q = scan_size (q, line_end, &v2)) || v1 >= chunk->size
+          || v2 >= chunk->size)
         {
-          return false;
+          chunk->ok = false;
+          return NULL;
+        }
+      *out++ = v1;
+      *out++ = v2;
+      if (!weight)
+        continue;
+      float length;
+      if (scan_float (q, line_end, &length))
+        {
+          if (!(length >= 0))
+            {
+              chunk->ok = false;
+              return NULL;
+            }
+          *weight = edge_weight (length);
+        }
+      else if (chunk->coords)
+        {
+          const float *x = chunk->coords, *y = chunk->coords + chunk->size;
+          double dx = (double) x[v1] - x[v2], dy = (double) y[v1] - y[v2];
+          *weight = edge_weight (sqrt (dx * dx + dy * dy));
         }
-      // Appeler deux fois pour faire dans les deux sens
-      board_add_edge_uni (self->vertices[v1], self->vertices[v2]);
-      if (self->vertices[v1] != self->vertices[v2])
+      else
+        *weight = BOARD_WEIGHT_SCALE;
+      // Longueur trop grande pour être représentée
+      if (*weight++ == 0)
         {
-          board_add_edge_uni (self->vertices[v2], self->vertices[v1]);
+          chunk->ok = false;
+          return NULL;
         }
     }
+  return NULL;
+}
 
-  if (fgets (line, sizeof (line), file) != NULL)
+static size_t count_lines (const char *p, const char *end)
+{
+  size_t lines = 0;
+  while (p < end)
     {
-      return false;
+      const char *nl = memchr (p, '\n', end - p);
+      lines++;
+      p = nl ? nl + 1 : end;
     }
-
-  return true;
+  return lines;
 }
 
-void board_destroy (board *self)
+/*
+ * Parse the edge section [p, end) into list, and into weights if not
+ * NULL. Large sections are cut at line boundaries and parsed on several
+ * threads, each one writing its pairs at the position given by the line
+ * counts of the chunks before it. The section must hold exactly edges
+ * lines.
+ */
+static bool parse_edges (const char *p, const char *end, size_t edges,
+                         size_t size, uint32_t *list, const float *coords,
+                         uint32_t *weights)
 {
-  if (!self)
-    return;
-  for (size_t i = 0; i < self->size; i++)
-    {
-      /* for (size_t j = 0; j < self->vertices[i]->degree; j++) { */
-      /*   free(self->vertices[i]->neighbors[j]); */
-      /* } */
-      free (self->vertices[i]->optim);
-      free (self->vertices[i]->neighbors);
-      free (self->vertices[i]);
-    }
-  free (self->vertices);
-  if (self->dist)
+  size_t nthreads = (end - p) / BOARD_PARSE_CHUNK + 1;
+  if (nthreads > thread_count (BOARD_PARSE_THREADS))
+    nthreads = thread_count (BOARD_PARSE_THREADS);
+
+  edge_chunk chunks[BOARD_PARSE_THREADS];
+  size_t total = 0;
+  for (size_t t = 0; t < nthreads; t++)
     {
-      for (size_t i = 0; i < self->size; i++)
-        free (self->dist[i]);
-      free (self->dist);
+      const char *stop = t + 1 == nthreads ? end
+        : p + (end - p) * (t + 1) / nthreads;
+      const char *nl = stop < end ? memchr (stop, '\n', end - stop) : NULL;
+      chunks[t].begin = t == 0 ? p : chunks[t - 1].end;
+      chunks[t].end = nl ? nl + 1 : end;
+      if (chunks[t].end < chunks[t].begin)
+        chunks[t].end = chunks[t].begin;
+      chunks[t].lines = count_lines (chunks[t].begin, chunks[t].end);
+      chunks[t].first = total;
+      chunks[t].size = size;
+      chunks[t].list = list;
+      chunks[t].coords = coords;
+      chunks[t].weights = weights;
+      total += chunks[t].lines;
     }
+  // Moins de lignes que déclaré, ou des données en trop après les arêtes
+  if (total != edges)
+    return false;
 
-  if (self->next)
+  pthread_t threads[BOARD_PARSE_THREADS];
+  size_t started = 1;
+  for (; started < nthreads; started++)
+    if (pthread_create (&threads[started], NULL, parse_edge_chunk,
+                        &chunks[started]) != 0)
+      break;
+  parse_edge_chunk (&chunks[0]);
+  // Parties dont le thread n'a pas pu être créé
+  for (size_t t = started; t < nthreads; t++)
+    parse_edge_chunk (&chunks[t]);
+  bool ok = chunks[0].ok;
+  for (size_t t = 1; t < nthreads; t++)
     {
-      for (size_t i = 0; i < self->size; i++)
-        free (self->next[i]);
-      free (self->next);
+      if (t < started)
+        pthread_join (threads[t], NULL);
+      ok = ok && chunks[t].ok;
     }
+  return ok;
 }
 
-bool board_is_valid_move (board *self, size_t source, size_t dest)
+/*
+ * Set max_edge to the length of the longest edge, slightly rounded up
+ * so that it stays an upper bound despite float rounding
+ */
+static void board_measure_edges (board *self)
 {
-  if (!self)
-    return false;
-  if (source >= self->size || dest >= self->size)
-    return false;
-  if (source == dest)
-    {
-      return true;
-    }
-  for (size_t i = 0; i < self->vertices[source]->degree; i++)
+  double longest = 0;
+  for (size_t u = 0; self->x && u < self->size; u++)
     {
-      if (self->vertices[source]->neighbors[i]->index == dest)
+      const uint32_t *neighbors = board_neighbors (self, u);
+      for (size_t i = 0; i < board_degree (self, u); i++)
         {
-          return true;
+          double dx = (double) self->x[u] - self->x[neighbors[i]];
+          double dy = (double) self->y[u] - self->y[neighbors[i]];
+          double length = sqrt (dx * dx + dy * dy);
+          longest = length > longest ? length : longest;
         }
     }
-  return false;
+  self->max_edge = longest * (1 + 1e-6);
 }
 
-void board_Floyd_Warshall (board *self)
+static bool board_lengths_fit (board *self);
+
+/*
+ * Parse a whole map file held in memory
+ */
+static bool board_parse (board *self, const char *p, size_t len)
 {
-  if (!self || self->size == 0)
-    return;
-  self->dist = malloc (self->size * sizeof (*self->dist));
-  self->next = malloc (self->size * sizeof (*self->next));
-  for (size_t u = 0; u < self->size; u++)
+  const char *end = p + len, *line_end;
+
+  if (!(p = scan_header (p, end, "Cops: ", &(self->cops)))
+      || self->cops == 0)
+    return false;
+  if (!(p = scan_header (p, end, "Robbers: ", &(self->robbers)))
+      || self->robbers == 0)
+    return false;
+  if (!(p = scan_header (p, end, "Max turn: ", &(self->max_turn)))
+      || self->max_turn == 0)
+    return false;
+  if (!(p = scan_header (p, end, "Vertices: ", &(self->size)))
+      || self->size == 0 || self->size >= UINT32_MAX)
+    return false;
+
+  // Sans mémoire pour les coordonnées, on lit quand même le plateau
+  float *coords = malloc (2 * self->size * sizeof (*coords));
+  for (size_t i = 0; i < self->size; i++)
     {
-      self->dist[u] = malloc (self->size * sizeof (**self->dist));
-      self->next[u] = malloc (self->size * sizeof (**self->next));
-      for (size_t v = 0; v < self->size; v++)
+      const char *line = p;
+      if (!(p = next_line (p, end, &line_end)))
+        {
+          free (coords);
+          return false;
+        }
+      if (coords && (!(line = scan_float (line, line_end, &coords[i]))
+                     || !scan_float (line, line_end,
+                                     &coords[self->size + i])))
         {
-          self->dist[u][v] = INT_MAX;
-          self->next[u][v] = INT_MAX;
+          free (coords);
+          coords = NULL;
         }
     }
 
-  // Initialiser les distances pour les voisins directs
-  for (size_t u = 0; u < self->size; u++)
+  size_t edges = 0;
+  if (!(p = scan_header (p, end, "Edges: ", &edges))
+      || edges > SIZE_MAX / (6 * sizeof (uint32_t)))
     {
-      for (size_t i = 0; i < self->vertices[u]->degree; i++)
-        {
-          size_t v = self->vertices[u]->neighbors[i]->index;    // Index du voisin
-          self->dist[u][v] = 1; // car il y a une arête entre u et v
-          self->next[u][v] = v; // Le prochain sommet est v
-        }
+      free (coords);
+      return false;
     }
 
-  for (size_t v = 0; v < self->size; v++)
+  // Première passe : on garde les arêtes pour compter les degrés, et
+  // leurs longueurs après les paires
+  uint32_t *list = malloc ((edges ? edges : 1) * (self->weighted ? 3 : 2)
+                           * sizeof (*list));
+  uint32_t *weights = list && self->weighted ? list + 2 * edges : NULL;
+  if (!list || !parse_edges (p, end, edges, self->size, list, coords,
+                             weights))
     {
-      self->dist[v][v] = 0;     // Distance de chaque sommet à lui-même = 0
-      self->next[v][v] = v;     // Le prochain sommet est lui-même
+      free (list);
+      free (coords);
+      return false;
     }
 
-  for (size_t w = 0; w < self->size; w++)
+  // Deuxième passe : construction de l'adjacence dans les deux sens
+  bool built = board_build_adjacency (self, list, weights, edges);
+  free (list);
+  if (!built)
     {
-      for (size_t u = 0; u < self->size; u++)
+      free (coords);
+      return false;
+    }
+  self->x = coords;
+  self->y = coords ? coords + self->size : NULL;
+  board_measure_edges (self);
+  return board_find_components (self) && board_lengths_fit (self);
+}
+
+bool board_read_from (board *self, FILE *file)
+{
+  if (!self || !file)
+    return false;
+  size_t len = 0, capacity = 4096;
+  char *data = malloc (capacity);
+  if (!data)
+    return false;
+  size_t got;
+  while ((got = fread (data + len, 1, capacity - len, file)) > 0)
+    {
+      len += got;
+      if (len == capacity)
         {
-          for (size_t v = 0; v < self->size; v++)
+          char *bigger = realloc (data, 2 * capacity);
+          if (!bigger)
             {
-              if (self->dist[u][v] > self->dist[u][w] + self->dist[w][v])
-                {
-                  self->dist[u][v] = self->dist[u][w] + self->dist[w][v];
-                  self->next[u][v] = self->next[u][w];
-                }
+              free (data);
+              return false;
             }
+          data = bigger;
+          capacity *= 2;
         }
     }
+  bool read = board_parse (self, data, len);
+  free (data);
+  return read;
 }
 
-size_t board_dist (board *self, size_t source, size_t dest)
+bool board_load (board *self, const char *filename)
 {
-  /* if (!self || self->size == 0) */
-  /*      return -1; */
-  /* if (source >= self->size || dest >= self->size) */
-  /*      return -1; */
-  /* if (self->dist == NULL || self->next == NULL) */
-  /*      return -1; */
-  if (!self)
-    return 0;
-  if (!self->dist)
+  if (!self || !filename)
+    return false;
+  int fd = open (filename, O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  if (fstat (fd, &st) != 0 || st.st_size == 0)
     {
-      board_Floyd_Warshall (self);
+      close (fd);
+      return false;
     }
-  /* if (self->dist[source][dest] == UINT_MAX) { */
-  /*      return -1; */
-  /* } */
-  return self->dist[source][dest];
+  void *data = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (data == MAP_FAILED)
+    return false;
+  madvise (data, st.st_size, MADV_SEQUENTIAL);
+  bool read = board_parse (self, data, st.st_size);
+  munmap (data, st.st_size);
+  return read;
 }
 
-size_t board_next (board *self, size_t source, size_t dest)
+bool board_write_binary (board *self, FILE *file)
 {
-  /* if (!self || self->size == 0) */
-  /*      return -1; */
-  /* if (source >= self->size || dest >= self->size) */
-  /*      return -1; */
-  /* if (self->dist == NULL || self->next == NULL) */
-  /*      return -1; */
-  if (!self)
-    return 0;
-  if (!self->next)
+  if (!self || !file || !self->offsets || self->order)
+    return false;
+  board_binary_header header;
+  memset (&header, 0, sizeof (header));
+  memcpy (header.magic, BOARD_BINARY_MAGIC, sizeof (header.magic));
+  header.version = BOARD_BINARY_VERSION;
+  header.cops = self->cops;
+  header.robbers = self->robbers;
+  header.max_turn = self->max_turn;
+  header.size = self->size;
+  header.nadj = self->offsets[self->size];
+  header.flags = (self->simplify ? BOARD_BINARY_SIMPLIFIED : 0)
+    | (self->x ? BOARD_BINARY_COORDS : 0)
+    | (self->weights ? BOARD_BINARY_WEIGHTS : 0);
+  header.max_edge = self->max_edge;
+  return fwrite (&header, sizeof (header), 1, file) == 1
+    && fwrite (self->offsets, sizeof (*self->offsets), self->size + 1,
+               file) == self->size + 1
+    && fwrite (self->adj, sizeof (*self->adj), header.nadj,
+               file) == header.nadj
+    && (!self->x || (fwrite (self->x, sizeof (*self->x), self->size, file)
+                     == self->size
+                     && fwrite (self->y, sizeof (*self->y), self->size,
+                                file) == self->size))
+    && (!self->weights || fwrite (self->weights, sizeof (*self->weights),
+                                  header.nadj, file) == header.nadj);
+}
+
+static bool binary_has_coords (const board_binary_header *header)
+{
+  return header->version >= 2 && (header->flags & BOARD_BINARY_COORDS);
+}
+
+static bool binary_has_weights (const board_binary_header *header)
+{
+  return header->version >= 2 && (header->flags & BOARD_BINARY_WEIGHTS);
+}
+
+static uint64_t binary_file_size (const board_binary_header *header)
+{
+  return sizeof (*header)
+    + (header->size + 1 + header->nadj) * sizeof (uint32_t)
+    + (binary_has_coords (header) ? 2 * header->size * sizeof (float) : 0)
+    + (binary_has_weights (header) ? header->nadj * sizeof (uint32_t) : 0);
+}
+
+bool board_read_binary (board *self, const char *filename)
+{
+  if (!self || !filename)
+    return false;
+  int fd = open (filename, O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  board_binary_header header;
+  if (fstat (fd, &st) != 0 || (size_t) st.st_size < sizeof (header)
+      || read (fd, &header, sizeof (header)) != sizeof (header)
+      || memcmp (header.magic, BOARD_BINARY_MAGIC, sizeof (header.magic))
+      || header.version < 1 || header.version > BOARD_BINARY_VERSION
+      || header.cops == 0 || header.robbers == 0 || header.max_turn == 0
+      || header.size == 0 || header.size >= UINT32_MAX
+      || header.nadj >= UINT32_MAX
+      || (self->weighted && !binary_has_weights (&header))
+      || (uint64_t) st.st_size != binary_file_size (&header))
     {
-      board_Floyd_Warshall (self);
+      close (fd);
+      return false;
+    }
+  void *data = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (data == MAP_FAILED)
+    return false;
+
+  uint32_t *offsets = (uint32_t *) ((char *) data + sizeof (header));
+  bool valid = offsets[0] == 0 && offsets[header.size] == header.nadj;
+  for (size_t v = 0; valid && v < header.size; v++)
+    valid = offsets[v] <= offsets[v + 1];
+  // Un voisin hors du plateau ferait lire hors des tables ensuite
+  const uint32_t *adj = offsets + header.size + 1;
+  for (size_t i = 0; valid && i < header.nadj; i++)
+    valid = adj[i] < header.size;
+  if (!valid)
+    {
+      munmap (data, st.st_size);
+      return false;
+    }
+
+  bool coords = binary_has_coords (&header);
+  board loaded = *self;
+  loaded.cops = header.cops;
+  loaded.robbers = header.robbers;
+  loaded.max_turn = header.max_turn;
+  loaded.size = header.size;
+  loaded.simplify = header.flags & BOARD_BINARY_SIMPLIFIED;
+  loaded.removed_edges = 0;
+  loaded.map = data;
+  loaded.map_len = st.st_size;
+  loaded.offsets = offsets;
+  loaded.adj = offsets + header.size + 1;
+  loaded.x = coords ? (float *) (loaded.adj + header.nadj) : NULL;
+  loaded.y = coords ? loaded.x + header.size : NULL;
+  loaded.max_edge = coords ? header.max_edge : 0;
+  // Après les coordonnées s'il y en a
+  loaded.weights = !self->weighted ? NULL
+    : (uint32_t *) ((char *) data + binary_file_size (&header)
+                    - header.nadj * sizeof (uint32_t));
+
+  // Longueurs hors bornes, ou chemins trop longs pour les distances
+  for (size_t i = 0; loaded.weights && valid && i < header.nadj; i++)
+    valid = loaded.weights[i] >= 1 && loaded.weights[i] <= BOARD_WEIGHT_MAX;
+  if (valid && loaded.weights)
+    valid = board_find_components (&loaded) && board_lengths_fit (&loaded);
+  if (!valid)
+    {
+      if (loaded.comp != self->comp)
+        {
+          free (loaded.comp);
+          free (loaded.comp_start);
+          free (loaded.comp_block);
+        }
+      munmap (data, st.st_size);
+      return false;
+    }
+  *self = loaded;
+  return true;
+}
+
+/*
+ * Free everything derived from the adjacency
+ */
+static void board_free_row_cache (board *self)
+{
+  if (!self->row_cache)
+    return;
+  free (self->row_cache->source);
+  free (self->row_cache->slot);
+  free (self->row_cache->dist);
+  free (self->row_cache->scratch);
+  free (self->row_cache);
+  self->row_cache = NULL;
+}
+
+static void board_free_landmarks (board *self)
+{
+  if (!self->landmarks)
+    return;
+  free (self->landmarks->vertex);
+  free (self->landmarks->dist);
+  free (self->landmarks->forward);
+  free (self->landmarks->queue);
+  free (self->landmarks);
+  self->landmarks = NULL;
+}
+
+static void shm_name (char *name, size_t len, uint64_t hash)
+{
+  snprintf (name, len, BOARD_SHM_PREFIX "%016llx", (unsigned long long) hash);
+}
+
+/*
+ * Count one more process attached to a segment, unless the count has
+ * already fallen to 0: the last process detached is then removing its
+ * name, and a new segment may take that name, so it must not be used
+ */
+static bool tables_ref (board_tables_header *header)
+{
+  uint32_t refs = __atomic_load_n (&header->refs, __ATOMIC_ACQUIRE);
+  while (refs != 0)
+    if (__atomic_compare_exchange_n (&header->refs, &refs, refs + 1, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+      return true;
+  return false;
+}
+
+/*
+ * Count one process less attached to a segment, the last one removing
+ * its name
+ */
+static void tables_unref (board_tables_header *header)
+{
+  if (__atomic_sub_fetch (&header->refs, 1, __ATOMIC_ACQ_REL) == 0)
+    {
+      char name[64];
+      shm_name (name, sizeof (name), header->hash);
+      shm_unlink (name);
+    }
+}
+
+/*
+ * Drop dist and next if they point into a tables file or a shared
+ * segment, the last process detached from a segment removing it
+ */
+static void board_unmap_tables (board *self)
+{
+  if (self->tables_shared)
+    {
+      board_tables_header *header = self->tables_shared;
+      tables_unref (header);
+      munmap (self->tables_shared, sizeof (*header));
+      self->tables_shared = NULL;
+    }
+  if (!self->tables_map)
+    return;
+  munmap (self->tables_map, self->tables_map_len);
+  self->tables_map = NULL;
+  self->tables_map_len = 0;
+  self->dist = NULL;
+  self->next = NULL;
+}
+
+static void board_free_tables (board *self)
+{
+  board_unmap_tables (self);
+  free (self->adj_bits);
+  free (self->adj_sorted);
+  self->adj_bits = NULL;
+  self->adj_sorted = NULL;
+  self->adj_indexed = false;
+  free (self->comp);
+  free (self->comp_start);
+  free (self->comp_block);
+  free (self->dist);
+  free (self->next);
+  self->ncomps = 0;
+  self->comp = NULL;
+  self->comp_pos = NULL;
+  self->comp_members = NULL;
+  self->comp_start = NULL;
+  self->comp_block = NULL;
+  self->dist_block = NULL;
+  self->dist = NULL;
+  self->next = NULL;
+  board_free_row_cache (self);
+  board_free_landmarks (self);
+  hierarchy_destroy (self->hierarchy);
+  free (self->hierarchy);
+  self->hierarchy = NULL;
+  block_tree_destroy (self->block_tree);
+  free (self->block_tree);
+  self->block_tree = NULL;
+}
+
+void board_destroy (board *self)
+{
+  if (!self)
+    return;
+  if (self->map)
+    munmap (self->map, self->map_len);
+  else
+    {
+      free (self->offsets);
+      free (self->weights);
+      free (self->x);
+    }
+  free (self->order);
+  free (self->rank);
+  board_free_tables (self);
+}
+
+bool board_reorder (board *self)
+{
+  if (!self || !self->offsets || self->order)
+    return false;
+  size_t n = self->size;
+  uint32_t *order = malloc (n * sizeof (*order));
+  uint32_t *rank = malloc (n * sizeof (*rank));
+  // Clés (degré, sommet) pour trier par degré croissant avec qsort
+  uint64_t *keys = malloc (n * sizeof (*keys));
+  uint32_t *offsets = malloc ((n + 1 + self->offsets[n]) * sizeof (*offsets));
+  float *x = self->x ? malloc (2 * n * sizeof (*x)) : NULL;
+  uint32_t *weights = self->weights
+    ? malloc ((self->offsets[n] + 1) * sizeof (*weights)) : NULL;
+  if (!order || !rank || !keys || !offsets || (self->x && !x)
+      || (self->weights && !weights))
+    {
+      free (order);
+      free (rank);
+      free (keys);
+      free (offsets);
+      free (x);
+      free (weights);
+      return false;
+    }
+
+  for (size_t v = 0; v < n; v++)
+    {
+      keys[v] = (uint64_t) board_degree (self, v) << 32 | v;
+      rank[v] = UINT32_MAX;
+    }
+  qsort (keys, n, sizeof (*keys), compare_uint64);
+
+  // Parcours en largeur depuis le sommet de plus petit degré de chaque
+  // composante, voisins visités par degré croissant
+  size_t head = 0, tail = 0;
+  uint64_t *pending = malloc (n * sizeof (*pending));
+  for (size_t s = 0; pending && s < n; s++)
+    {
+      uint32_t seed = keys[s];
+      if (rank[seed] != UINT32_MAX)
+        continue;
+      rank[seed] = tail;
+      order[tail++] = seed;
+      while (head < tail)
+        {
+          uint32_t u = order[head++];
+          const uint32_t *neighbors = board_neighbors (self, u);
+          size_t npending = 0;
+          for (size_t i = 0; i < board_degree (self, u); i++)
+            if (rank[neighbors[i]] == UINT32_MAX)
+              {
+                rank[neighbors[i]] = 0;
+                pending[npending++] =
+                  (uint64_t) board_degree (self, neighbors[i]) << 32
+                  | neighbors[i];
+              }
+          qsort (pending, npending, sizeof (*pending), compare_uint64);
+          for (size_t i = 0; i < npending; i++)
+            order[tail++] = pending[i];
+        }
+    }
+  free (pending);
+  free (keys);
+  if (tail != n)
+    {
+      free (order);
+      free (rank);
+      free (offsets);
+      free (x);
+      free (weights);
+      return false;
+    }
+
+  // Ordre inversé (Reverse Cuthill-McKee)
+  for (size_t i = 0; i < n / 2; i++)
+    {
+      uint32_t tmp = order[i];
+      order[i] = order[n - 1 - i];
+      order[n - 1 - i] = tmp;
+    }
+  for (size_t v = 0; v < n; v++)
+    rank[order[v]] = v;
+
+  uint32_t *adj = offsets + n + 1;
+  offsets[0] = 0;
+  for (size_t v = 0; v < n; v++)
+    {
+      const uint32_t *neighbors = board_neighbors (self, order[v]);
+      size_t degree = board_degree (self, order[v]);
+      offsets[v + 1] = offsets[v] + degree;
+      for (size_t i = 0; i < degree; i++)
+        {
+          adj[offsets[v] + i] = rank[neighbors[i]];
+          if (weights)
+            weights[offsets[v] + i] =
+              self->weights[self->offsets[order[v]] + i];
+        }
+      if (x)
+        {
+          x[v] = self->x[order[v]];
+          x[n + v] = self->y[order[v]];
+        }
+    }
+
+  board_free_tables (self);
+  if (self->map)
+    munmap (self->map, self->map_len);
+  else
+    {
+      free (self->offsets);
+      free (self->weights);
+      free (self->x);
+    }
+  self->map = NULL;
+  self->offsets = offsets;
+  self->adj = adj;
+  self->weights = weights;
+  self->x = x;
+  self->y = x ? x + n : NULL;
+  self->order = order;
+  self->rank = rank;
+  return board_find_components (self);
+}
+
+bool board_index_adjacency (board *self)
+{
+  if (!self || !self->offsets)
+    return false;
+  if (self->adj_indexed)
+    return true;
+  if (self->size <= BOARD_ADJ_BITSET_MAX)
+    {
+      // Matrice d'adjacence compacte : un bit par couple (u, v)
+      size_t words = (self->size * self->size + 63) / 64;
+      self->adj_bits = calloc (words, sizeof (*self->adj_bits));
+      if (!self->adj_bits)
+        return false;
+      for (size_t u = 0; u < self->size; u++)
+        {
+          const uint32_t *neighbors = board_neighbors (self, u);
+          for (size_t i = 0; i < board_degree (self, u); i++)
+            {
+              size_t bit = u * self->size + neighbors[i];
+              self->adj_bits[bit / 64] |= (uint64_t) 1 << (bit % 64);
+            }
+        }
+      self->adj_indexed = true;
+      return true;
+    }
+
+  // Lignes déjà triées, comme dans une carte générée : recherche
+  // directe dans adj
+  bool sorted = true;
+  for (size_t u = 0; u < self->size && sorted; u++)
+    for (uint32_t i = self->offsets[u] + 1; i < self->offsets[u + 1]; i++)
+      sorted = sorted && self->adj[i - 1] <= self->adj[i];
+  if (sorted)
+    return self->adj_indexed = true;
+
+  // Copie triée de chaque ligne, l'ordre de adj reste celui du fichier
+  size_t n = self->offsets[self->size];
+  self->adj_sorted = malloc ((n ? n : 1) * sizeof (*self->adj_sorted));
+  if (!self->adj_sorted)
+    return false;
+  for (size_t i = 0; i < n; i++)
+    self->adj_sorted[i] = self->adj[i];
+  for (size_t u = 0; u < self->size; u++)
+    qsort (self->adj_sorted + self->offsets[u], board_degree (self, u),
+           sizeof (*self->adj_sorted), compare_uint32);
+  return self->adj_indexed = true;
+}
+
+/*
+ * Branch-free binary search of key in the sorted array base[0..n)
+ */
+static bool sorted_contains (const uint32_t *base, size_t n, uint32_t key)
+{
+  if (n == 0)
+    return false;
+  while (n > 1)
+    {
+      size_t half = n / 2;
+      base += (base[half] <= key) ? half : 0;
+      n -= half;
+    }
+  return *base == key;
+}
+
+bool board_is_valid_move (const board *self, size_t source, size_t dest)
+{
+  if (!self)
+    return false;
+  if (source >= self->size || dest >= self->size)
+    return false;
+  if (source == dest)
+    {
+      return true;
+    }
+  // Sans l'index de board_prepare, on parcourt les voisins
+  if (!self->adj_indexed)
+    {
+      const uint32_t *neighbors = board_neighbors (self, source);
+      for (size_t i = 0; i < board_degree (self, source); i++)
+        if (neighbors[i] == dest)
+          return true;
+      return false;
+    }
+  if (self->adj_bits)
+    {
+      size_t bit = source * self->size + dest;
+      return (self->adj_bits[bit / 64] >> (bit % 64)) & 1;
+    }
+  const uint32_t *rows = self->adj_sorted ? self->adj_sorted : self->adj;
+  return sorted_contains (rows + self->offsets[source],
+                          board_degree (self, source), dest);
+}
+
+bool board_find_components (board *self)
+{
+  if (!self || !self->offsets)
+    return false;
+  if (self->comp)
+    return true;
+  size_t n = self->size;
+  // comp, comp_pos et comp_members partagent une seule allocation
+  uint32_t *comp = malloc (3 * n * sizeof (*comp));
+  uint32_t *queue = malloc (n * sizeof (*queue));
+  if (!comp || !queue)
+    {
+      free (comp);
+      free (queue);
+      return false;
+    }
+  for (size_t v = 0; v < n; v++)
+    comp[v] = UINT32_MAX;
+
+  // Parcours en largeur depuis chaque sommet pas encore atteint
+  size_t ncomps = 0;
+  for (size_t s = 0; s < n; s++)
+    {
+      if (comp[s] != UINT32_MAX)
+        continue;
+      size_t head = 0, tail = 0;
+      comp[s] = ncomps;
+      queue[tail++] = s;
+      while (head < tail)
+        {
+          uint32_t u = queue[head++];
+          const uint32_t *neighbors = board_neighbors (self, u);
+          for (size_t i = 0; i < board_degree (self, u); i++)
+            if (comp[neighbors[i]] == UINT32_MAX)
+              {
+                comp[neighbors[i]] = ncomps;
+                queue[tail++] = neighbors[i];
+              }
+        }
+      ncomps++;
+    }
+  uint32_t *start = calloc (ncomps + 1, sizeof (*start));
+  // Blocs de next puis triangles de dist
+  size_t *block = malloc (2 * (ncomps + 1) * sizeof (*block));
+  if (!start || !block)
+    {
+      free (comp);
+      free (queue);
+      free (start);
+      free (block);
+      return false;
+    }
+  uint32_t *pos = comp + n, *members = comp + 2 * n;
+  for (size_t v = 0; v < n; v++)
+    start[comp[v] + 1]++;
+  size_t *triangle = block + ncomps + 1;
+  block[0] = 0;
+  triangle[0] = 0;
+  for (size_t c = 0; c < ncomps; c++)
+    {
+      size_t size = start[c + 1];
+      start[c + 1] += start[c];
+      block[c + 1] = block[c] + size * size;
+      triangle[c + 1] = triangle[c] + size * (size + 1) / 2;
+    }
+  // Sommets de chaque composante par indice croissant, queue sert de
+  // curseur de remplissage
+  for (size_t c = 0; c < ncomps; c++)
+    queue[c] = start[c];
+  for (size_t v = 0; v < n; v++)
+    {
+      pos[v] = queue[comp[v]] - start[comp[v]];
+      members[queue[comp[v]]++] = v;
+    }
+  free (queue);
+
+  self->ncomps = ncomps;
+  self->comp = comp;
+  self->comp_pos = pos;
+  self->comp_members = members;
+  self->comp_start = start;
+  self->comp_block = block;
+  self->dist_block = triangle;
+  return true;
+}
+
+/*
+ * Radix heap of (key, vertex) items whose keys are never below the last
+ * key popped: bucket 0 holds the items of that key, bucket b > 0 those
+ * whose key first differs from it at bit b - 1. Popping from an empty
+ * bucket 0 takes the smallest key of the first bucket that is not, and
+ * its items all move to smaller buckets.
+ */
+typedef struct
+{
+  uint64_t *items;
+  size_t len;
+  size_t capacity;
+} radix_bucket;
+
+typedef struct
+{
+  radix_bucket buckets[33];
+  uint32_t last;
+  size_t len;
+} radix_heap;
+
+static bool radix_push (radix_heap *heap, uint32_t key, uint32_t v)
+{
+  radix_bucket *bucket = &heap->buckets[key == heap->last ? 0
+                                        : 32 - __builtin_clz (key
+                                                              ^ heap->last)];
+  if (bucket->len == bucket->capacity)
+    {
+      size_t capacity = bucket->capacity ? 2 * bucket->capacity : 16;
+      uint64_t *items = realloc (bucket->items, capacity * sizeof (*items));
+      if (!items)
+        return false;
+      bucket->items = items;
+      bucket->capacity = capacity;
+    }
+  bucket->items[bucket->len++] = (uint64_t) key << 32 | v;
+  heap->len++;
+  return true;
+}
+
+static bool radix_pop (radix_heap *heap, uint64_t *item)
+{
+  if (heap->buckets[0].len == 0)
+    {
+      radix_bucket *bucket = heap->buckets + 1;
+      while (bucket->len == 0)
+        bucket++;
+      uint64_t min = UINT64_MAX;
+      for (size_t i = 0; i < bucket->len; i++)
+        min = bucket->items[i] < min ? bucket->items[i] : min;
+      heap->last = min >> 32;
+      size_t len = bucket->len;
+      bucket->len = 0;
+      heap->len -= len;
+      for (size_t i = 0; i < len; i++)
+        if (!radix_push (heap, bucket->items[i] >> 32, bucket->items[i]))
+          return false;
+    }
+  heap->len--;
+  *item = heap->buckets[0].items[--heap->buckets[0].len];
+  return true;
+}
+
+/*
+ * Dijkstra search from all the sources at once, each vertex getting its
+ * distance to the nearest one (INT_MAX if none is connected to it)
+ */
+static bool dijkstra_sources (const board *self, const uint32_t *sources,
+                              size_t nsources, unsigned int *dist)
+{
+  for (size_t v = 0; v < self->size; v++)
+    dist[v] = INT_MAX;
+  radix_heap heap;
+  memset (&heap, 0, sizeof (heap));
+  bool ok = true;
+  for (size_t i = 0; ok && i < nsources; i++)
+    {
+      dist[sources[i]] = 0;
+      ok = radix_push (&heap, 0, sources[i]);
+    }
+  uint64_t item;
+  while (ok && heap.len > 0 && (ok = radix_pop (&heap, &item)))
+    {
+      uint32_t u = item, d = item >> 32;
+      // Entrée périmée, u a été atteint plus court depuis
+      if (d > dist[u])
+        continue;
+      const uint32_t *neighbors = board_neighbors (self, u);
+      for (size_t i = 0; ok && i < board_degree (self, u); i++)
+        {
+          uint32_t v = neighbors[i], length = edge_length (self, u, i);
+          if (d + length < dist[v])
+            {
+              dist[v] = d + length;
+              ok = radix_push (&heap, d + length, v);
+            }
+        }
+    }
+  for (size_t b = 0; b < 33; b++)
+    free (heap.buckets[b].items);
+  return ok;
+}
+
+bool board_dijkstra (const board *self, size_t source, unsigned int *dist)
+{
+  if (!self || !self->offsets || source >= self->size || !dist)
+    return false;
+  uint32_t s = source;
+  return dijkstra_sources (self, &s, 1, dist);
+}
+
+/*
+ * Distances from source to every vertex: breadth-first search with
+ * queue, of size entries, as its queue, or Dijkstra's algorithm with
+ * weights
+ */
+static bool single_source (const board *self, uint32_t source,
+                           unsigned int *dist, uint32_t *queue)
+{
+  if (self->weights)
+    return dijkstra_sources (self, &source, 1, dist);
+  for (size_t v = 0; v < self->size; v++)
+    dist[v] = INT_MAX;
+  size_t head = 0, tail = 0;
+  queue[tail++] = source;
+  dist[source] = 0;
+  while (head < tail)
+    {
+      uint32_t u = queue[head++];
+      const uint32_t *neighbors = board_neighbors (self, u);
+      for (size_t i = 0; i < board_degree (self, u); i++)
+        if (dist[neighbors[i]] == INT_MAX)
+          {
+            dist[neighbors[i]] = dist[u] + 1;
+            queue[tail++] = neighbors[i];
+          }
+    }
+  return true;
+}
+
+/*
+ * Upper bound on the diameter of the components. From any vertex, a
+ * farthest vertex a, then a farthest vertex b from a, are far apart;
+ * the vertex halfway between them on a shortest path has an
+ * eccentricity close to half the diameter, and at least that. Twice
+ * this eccentricity is the bound. Every search runs from one vertex
+ * per component at once. Return UINT64_MAX if memory is missing.
+ */
+static uint64_t board_diameter_bound (const board *self)
+{
+  size_t n = self->size, ncomps = self->ncomps;
+  unsigned int *from_a = malloc (2 * n * sizeof (*from_a));
+  uint32_t *sources = malloc (ncomps * sizeof (*sources));
+  uint64_t *best = malloc (3 * ncomps * sizeof (*best));
+  uint64_t bound = UINT64_MAX;
+  if (!from_a || !sources || !best)
+    goto end;
+  unsigned int *from_b = from_a + n;
+  for (size_t c = 0; c < ncomps; c++)
+    sources[c] = self->comp_members[self->comp_start[c]];
+
+  // Deux balayages : sommet le plus loin du premier, puis de celui-là
+  for (size_t sweep = 0; sweep < 2; sweep++)
+    {
+      if (!dijkstra_sources (self, sources, ncomps, from_a))
+        goto end;
+      memset (best, 0, ncomps * sizeof (*best));
+      for (size_t v = 0; v < n; v++)
+        {
+          uint64_t key = (uint64_t) from_a[v] << 32 | v;
+          best[self->comp[v]] = key > best[self->comp[v]] ? key
+            : best[self->comp[v]];
+        }
+      for (size_t c = 0; c < ncomps; c++)
+        sources[c] = best[c];
+    }
+
+  // Milieu d'un plus court chemin de a à b : parmi les sommets les plus
+  // proches de la moitié, celui du milieu par indice et non le premier,
+  // qui serait un coin pour une grille dont tous les sommets sont sur
+  // un plus court chemin d'un coin à l'autre
+  if (!dijkstra_sources (self, sources, ncomps, from_b))
+    goto end;
+  uint64_t *length = best, *gap = best + ncomps, *count = best + 2 * ncomps;
+  for (size_t c = 0; c < ncomps; c++)
+    {
+      length[c] = from_a[sources[c]];
+      gap[c] = UINT64_MAX;
+      count[c] = 0;
+    }
+  // from_b reçoit l'écart à la moitié (UINT_MAX hors des plus courts
+  // chemins), puis on compte les sommets à l'écart minimal
+  for (size_t v = 0; v < n; v++)
+    {
+      uint32_t c = self->comp[v];
+      uint64_t twice = 2 * (uint64_t) from_a[v];
+      if (from_a[v] + from_b[v] != length[c])
+        from_b[v] = UINT_MAX;
+      else
+        {
+          from_b[v] = twice > length[c] ? twice - length[c]
+            : length[c] - twice;
+          gap[c] = from_b[v] < gap[c] ? from_b[v] : gap[c];
+        }
+    }
+  for (size_t v = 0; v < n; v++)
+    count[self->comp[v]] += from_b[v] == gap[self->comp[v]];
+  for (size_t c = 0; c < ncomps; c++)
+    count[c] = (count[c] + 1) / 2;
+  for (size_t v = 0; v < n; v++)
+    if (from_b[v] == gap[self->comp[v]] && --count[self->comp[v]] == 0)
+      sources[self->comp[v]] = v;
+  if (!dijkstra_sources (self, sources, ncomps, from_a))
+    goto end;
+  bound = 0;
+  for (size_t v = 0; v < n; v++)
+    bound = 2 * (uint64_t) from_a[v] > bound ? 2 * (uint64_t) from_a[v]
+      : bound;
+end:
+  free (from_a);
+  free (sources);
+  free (best);
+  return bound;
+}
+
+/*
+ * Whether every distance of a weighted board stays below INT_MAX, which
+ * stands for unreachable in all the backends. A path of a component is
+ * no longer than its edges put end to end, nor than one less than its
+ * vertices times its longest edge; the diameter bound is only computed
+ * when these do not suffice. Always true without weights.
+ */
+static bool board_lengths_fit (board *self)
+{
+  if (!self->weights)
+    return true;
+  uint64_t *total = calloc (2 * self->ncomps, sizeof (*total));
+  if (!total)
+    return false;
+  uint64_t *longest = total + self->ncomps;
+  for (size_t u = 0; u < self->size; u++)
+    for (size_t i = self->offsets[u]; i < self->offsets[u + 1]; i++)
+      {
+        uint32_t c = self->comp[u];
+        total[c] += self->weights[i];
+        longest[c] = self->weights[i] > longest[c] ? self->weights[i]
+          : longest[c];
+      }
+  bool fit = true;
+  for (size_t c = 0; fit && c < self->ncomps; c++)
+    {
+      uint64_t edges = self->comp_start[c + 1] - self->comp_start[c] - 1;
+      fit = total[c] < INT_MAX || edges * longest[c] < INT_MAX;
+    }
+  free (total);
+  return fit || board_diameter_bound (self) < INT_MAX;
+}
+
+/*
+ * Width of the distance entries, the smallest one holding the diameter
+ * bound below its largest value
+ */
+static size_t board_dist_width (const board *self)
+{
+  uint64_t bound = board_diameter_bound (self);
+  return bound < UINT8_MAX ? 1 : (bound < UINT16_MAX ? 2 : 4);
+}
+
+/*
+ * Allocate dist and next for every component, dropping the old ones
+ */
+static bool board_alloc_tables (board *self)
+{
+  if (!self || self->size == 0 || !board_find_components (self))
+    return false;
+  board_unmap_tables (self);
+  free (self->dist);
+  free (self->next);
+  self->dist = NULL;
+  self->dist_width = board_dist_width (self);
+  size_t bytes = self->dist_block[self->ncomps] * self->dist_width;
+  size_t align = bytes >= BOARD_DIST_HUGE ? BOARD_DIST_HUGE : 64;
+  if (posix_memalign (&self->dist, align, bytes ? bytes : 1))
+    self->dist = NULL;
+#ifdef MADV_HUGEPAGE
+  if (self->dist && bytes >= BOARD_DIST_HUGE)
+    madvise (self->dist, bytes - bytes % BOARD_DIST_HUGE, MADV_HUGEPAGE);
+#endif
+  // Des cases de voisins, le plus grand degré fixant la largeur
+  size_t degree = board_max_degree (self);
+  self->next_width = degree < UINT8_MAX ? 1 : (degree < UINT16_MAX ? 2 : 4);
+  self->next = malloc (self->comp_block[self->ncomps] * self->next_width);
+  if (!self->dist || !self->next)
+    {
+      free (self->dist);
+      free (self->next);
+      self->dist = NULL;
+      self->next = NULL;
+      return false;
+    }
+  return true;
+}
+
+/*
+ * Store the n distances of row at out, entries of the given width,
+ * values it cannot hold becoming the unreachable sentinel
+ */
+static void store_row (void *out, size_t width, const unsigned int *row,
+                       size_t n)
+{
+  if (width == 1)
+    for (size_t i = 0; i < n; i++)
+      ((uint8_t *) out)[i] = row[i] < UINT8_MAX ? row[i] : UINT8_MAX;
+  else if (width == 2)
+    for (size_t i = 0; i < n; i++)
+      ((uint16_t *) out)[i] = row[i] < UINT16_MAX ? row[i] : UINT16_MAX;
+  else
+    memcpy (out, row, n * sizeof (*row));
+}
+
+/*
+ * Store the n distances of row in dist from position cell
+ */
+static void dist_store_row (board *b, size_t cell, const unsigned int *row,
+                            size_t n)
+{
+  store_row ((char *) b->dist + cell * b->dist_width, b->dist_width, row, n);
+}
+
+static void dist_store (board *b, size_t cell, unsigned int d)
+{
+  dist_store_row (b, cell, &d, 1);
+}
+
+/*
+ * Store the n neighbor slots of row in next from position cell, at the
+ * width of the table, UINT32_MAX standing for the source itself
+ */
+static void next_store_row (board *b, size_t cell, const uint32_t *row,
+                            size_t n)
+{
+  if (b->next_width == 1)
+    {
+      uint8_t *out = (uint8_t *) b->next + cell;
+      for (size_t i = 0; i < n; i++)
+        out[i] = row[i] < UINT8_MAX ? row[i] : UINT8_MAX;
+    }
+  else if (b->next_width == 2)
+    {
+      uint16_t *out = (uint16_t *) b->next + cell;
+      for (size_t i = 0; i < n; i++)
+        out[i] = row[i] < UINT16_MAX ? row[i] : UINT16_MAX;
+    }
+  else
+    memcpy ((uint32_t *) b->next + cell, row, n * sizeof (*row));
+}
+
+/*
+ * Neighbor slot at position cell of next, UINT32_MAX for the source
+ * itself
+ */
+static uint32_t next_load (const board *b, size_t cell)
+{
+  if (b->next_width == 1)
+    {
+      uint8_t slot = ((const uint8_t *) b->next)[cell];
+      return slot == UINT8_MAX ? UINT32_MAX : slot;
+    }
+  if (b->next_width == 2)
+    {
+      uint16_t slot = ((const uint16_t *) b->next)[cell];
+      return slot == UINT16_MAX ? UINT32_MAX : slot;
+    }
+  return ((const uint32_t *) b->next)[cell];
+}
+
+/*
+ * Position in dist of the entry of positions (i, i) of component c,
+ * where row i of its triangle starts
+ */
+static size_t dist_row_cell (const board *b, uint32_t c, size_t i)
+{
+  size_t n = b->comp_start[c + 1] - b->comp_start[c];
+  return b->dist_block[c] + i * (2 * n - i - 1) / 2 + i;
+}
+
+/*
+ * Entry cell of a distance buffer of the given width, INT_MAX for the
+ * sentinel. Called with a constant width so that each caller gets its
+ * own loop.
+ */
+static inline unsigned int dist_load (const void *dist, size_t width,
+                                      size_t cell)
+{
+  if (width == 1)
+    {
+      uint8_t d = ((const uint8_t *) dist)[cell];
+      return d == UINT8_MAX ? INT_MAX : d;
+    }
+  if (width == 2)
+    {
+      uint16_t d = ((const uint16_t *) dist)[cell];
+      return d == UINT16_MAX ? INT_MAX : d;
+    }
+  uint32_t d = ((const uint32_t *) dist)[cell];
+  return d == UINT32_MAX ? INT_MAX : d;
+}
+
+static inline void dist_gather_width (const board *b, uint32_t c, size_t i,
+                                      unsigned int *out,
+                                      const uint32_t *members, size_t width)
+{
+  size_t n = b->comp_start[c + 1] - b->comp_start[c];
+  // Colonne i des lignes au-dessus, chacune plus courte d'une case
+  size_t column = b->dist_block[c] + i;
+  for (size_t j = 0; j < i; j++)
+    {
+      out[members ? members[j] : j] = dist_load (b->dist, width, column);
+      column += n - j - 1;
+    }
+  // Puis la ligne i elle-même, contiguë
+  size_t cell = dist_row_cell (b, c, i) - i;
+  for (size_t j = i; j < n; j++)
+    out[members ? members[j] : j] = dist_load (b->dist, width, cell + j);
+}
+
+/*
+ * Distances from position i of component c to every position j, into
+ * out[j], or out[members[j]] if members is not NULL: column i of the
+ * rows above row i, each row being one entry shorter than the one
+ * before, then row i itself. INT_MAX for unreachable.
+ */
+static void dist_gather (const board *b, uint32_t c, size_t i,
+                         unsigned int *out, const uint32_t *members)
+{
+  if (b->dist_width == 1)
+    dist_gather_width (b, c, i, out, members, 1);
+  else if (b->dist_width == 2)
+    dist_gather_width (b, c, i, out, members, 2);
+  else
+    dist_gather_width (b, c, i, out, members, 4);
+}
+
+/*
+ * Create the row cache, with as many rows as dist_cache_bytes holds but
+ * at least one
+ */
+static bool board_create_row_cache (board *self)
+{
+  if (self->row_cache)
+    return true;
+  if (self->size == 0 || !board_find_components (self))
+    return false;
+  size_t n = self->size;
+  self->dist_width = board_dist_width (self);
+  size_t rows = self->dist_cache_bytes / (n * self->dist_width);
+  rows = rows < 1 ? 1 : (rows > n ? n : rows);
+  board_row_cache *cache = calloc (1, sizeof (*cache));
+  if (!cache)
+    return false;
+  self->row_cache = cache;
+  // source, newer et older partagent une seule allocation
+  cache->source = malloc (3 * rows * sizeof (*cache->source));
+  cache->slot = malloc (n * sizeof (*cache->slot));
+  cache->dist = malloc (rows * n * self->dist_width);
+  cache->scratch = malloc (2 * n * sizeof (*cache->scratch));
+  if (!cache->source || !cache->slot || !cache->dist || !cache->scratch)
+    {
+      board_free_row_cache (self);
+      return false;
+    }
+  cache->newer = cache->source + rows;
+  cache->older = cache->source + 2 * rows;
+  cache->rows = rows;
+  cache->newest = cache->oldest = UINT32_MAX;
+  for (size_t v = 0; v < n; v++)
+    cache->slot[v] = UINT32_MAX;
+  return true;
+}
+
+/*
+ * Take row k out of the chain of used rows
+ */
+static void row_cache_unlink (board_row_cache *cache, uint32_t k)
+{
+  if (cache->newer[k] != UINT32_MAX)
+    cache->older[cache->newer[k]] = cache->older[k];
+  else
+    cache->newest = cache->older[k];
+  if (cache->older[k] != UINT32_MAX)
+    cache->newer[cache->older[k]] = cache->newer[k];
+  else
+    cache->oldest = cache->newer[k];
+}
+
+/*
+ * Put row k at the newest end of the chain
+ */
+static void row_cache_push (board_row_cache *cache, uint32_t k)
+{
+  cache->newer[k] = UINT32_MAX;
+  cache->older[k] = cache->newest;
+  if (cache->newest != UINT32_MAX)
+    cache->newer[cache->newest] = k;
+  else
+    cache->oldest = k;
+  cache->newest = k;
+}
+
+/*
+ * Row of distances from source, computed in a free row or in place of
+ * the least recently used one if it is not cached. NULL if memory is
+ * missing.
+ */
+static const void *row_cache_row (board *self, size_t source)
+{
+  board_row_cache *cache = self->row_cache;
+  size_t n = self->size;
+  uint32_t k = cache->slot[source];
+  if (k != UINT32_MAX)
+    {
+      cache->hits++;
+      if (cache->newest != k)
+        {
+          row_cache_unlink (cache, k);
+          row_cache_push (cache, k);
+        }
+      return (char *) cache->dist + k * n * self->dist_width;
+    }
+
+  cache->misses++;
+  unsigned int *dist = cache->scratch;
+  // La file du parcours occupe la seconde moitié
+  if (!single_source (self, source, dist, (uint32_t *) cache->scratch + n))
+    return NULL;
+  if (cache->used < cache->rows)
+    k = cache->used++;
+  else
+    {
+      k = cache->oldest;
+      row_cache_unlink (cache, k);
+      cache->slot[cache->source[k]] = UINT32_MAX;
+    }
+  void *row = (char *) cache->dist + k * n * self->dist_width;
+  store_row (row, self->dist_width, dist, n);
+  cache->source[k] = source;
+  cache->slot[source] = k;
+  row_cache_push (cache, k);
+  return row;
+}
+
+size_t board_cached_dist (const board *self, size_t source, size_t dest)
+{
+  if (!self || source >= self->size || dest >= self->size)
+    return INT_MAX;
+  // Le cache se met à jour à chaque requête, mais n'est créé que par
+  // board_prepare
+  board *b = (board *) self;
+  if (!b->row_cache)
+    return INT_MAX;
+  // Ligne de source si elle est déjà là, sinon celle de dest
+  bool from_source = b->row_cache->slot[source] != UINT32_MAX;
+  const void *row = row_cache_row (b, from_source ? source : dest);
+  return row ? dist_load (row, b->dist_width, from_source ? dest : source)
+    : INT_MAX;
+}
+
+/*
+ * Choose the landmarks by farthest-point selection and store their
+ * distances: each one is the vertex farthest from the landmarks already
+ * chosen, a component without any coming first, in which case a vertex
+ * at the end of it is taken rather than the first one
+ */
+static bool board_create_landmarks (board *self)
+{
+  if (self->landmarks)
+    return true;
+  if (self->size == 0 || !board_find_components (self))
+    return false;
+  size_t n = self->size;
+  size_t k = self->landmark_count < n ? self->landmark_count : n;
+  board_landmarks *marks = calloc (1, sizeof (*marks));
+  if (!marks)
+    return false;
+  self->landmarks = marks;
+  // forward et backward partagent une seule allocation
+  marks->vertex = malloc (k * sizeof (*marks->vertex));
+  marks->dist = malloc (k * n * sizeof (*marks->dist));
+  marks->forward = malloc (2 * n * sizeof (*marks->forward));
+  marks->queue = malloc (2 * n * sizeof (*marks->queue));
+  unsigned int *nearest = malloc (2 * n * sizeof (*nearest));
+  if (!marks->vertex || !marks->dist || !marks->forward || !marks->queue
+      || !nearest)
+    goto fail;
+  marks->backward = marks->forward + n;
+  marks->count = k;
+  unsigned int *row = nearest + n;
+  for (size_t v = 0; v < n; v++)
+    marks->forward[v] = marks->backward[v] = nearest[v] = INT_MAX;
+
+  uint32_t farthest = 0;
+  for (size_t i = 0; i < k; i++)
+    {
+      if (nearest[farthest] == INT_MAX)
+        {
+          uint32_t c = self->comp[farthest];
+          if (!single_source (self, farthest, row, marks->queue))
+            goto fail;
+          for (size_t j = self->comp_start[c]; j < self->comp_start[c + 1];
+               j++)
+            if (row[self->comp_members[j]] > row[farthest])
+              farthest = self->comp_members[j];
+        }
+      marks->vertex[i] = farthest;
+      if (!single_source (self, farthest, row, marks->queue))
+        goto fail;
+      // Distances rangées par sommet, celles d'un sommet étant lues ensemble
+      for (size_t v = 0; v < n; v++)
+        {
+          marks->dist[v * k + i] = row[v];
+          nearest[v] = row[v] < nearest[v] ? row[v] : nearest[v];
+        }
+      for (size_t v = 0; v < n; v++)
+        farthest = nearest[v] > nearest[farthest] ? v : farthest;
+    }
+  free (nearest);
+  return true;
+fail:
+  free (nearest);
+  board_free_landmarks (self);
+  return false;
+}
+
+/*
+ * Lower bound on the distance from v to the vertex whose landmark
+ * distances are goal: through any landmark L in their component,
+ * |d(L, v) - d(L, goal)| <= d(v, goal)
+ */
+static inline size_t landmark_lower (const board_landmarks *marks, size_t v,
+                                     const unsigned int *goal)
+{
+  const unsigned int *from = marks->dist + v * marks->count;
+  size_t lower = 0;
+  for (size_t k = 0; k < marks->count; k++)
+    if (from[k] != INT_MAX)
+      {
+        size_t gap = from[k] > goal[k] ? from[k] - goal[k]
+          : goal[k] - from[k];
+        lower = gap > lower ? gap : lower;
+      }
+  return lower;
+}
+
+/*
+ * Bounds from the triangle inequality, the upper one being
+ * d(u, v) <= d(L, u) + d(L, v)
+ */
+static void landmark_bounds (const board *self, size_t u, size_t v,
+                             size_t *lower, size_t *upper)
+{
+  *lower = *upper = self->comp[u] != self->comp[v] ? INT_MAX : 0;
+  if (self->comp[u] != self->comp[v] || u == v)
+    return;
+  const board_landmarks *marks = self->landmarks;
+  const unsigned int *from = marks->dist + u * marks->count;
+  const unsigned int *to = marks->dist + v * marks->count;
+  *lower = landmark_lower (marks, u, to);
+  *upper = INT_MAX;
+  for (size_t k = 0; k < marks->count; k++)
+    if (from[k] != INT_MAX && (size_t) from[k] + to[k] < *upper)
+      *upper = (size_t) from[k] + to[k];
+}
+
+/*
+ * Breadth-first searches from both ends, the smaller frontier growing
+ * by one level at a time. Once the two radii add up to r, every path of
+ * at most r edges has a vertex reached from both sides, so the search
+ * stops when they reach the best meeting found or limit.
+ */
+static size_t bidirectional_bfs (const board *self, uint32_t source,
+                                 uint32_t dest, size_t limit)
+{
+  board_landmarks *marks = self->landmarks;
+  unsigned int *side[2] = { marks->forward, marks->backward };
+  uint32_t *queue[2] = { marks->queue, marks->queue + self->size };
+  size_t head[2] = { 0, 0 }, tail[2] = { 1, 1 }, radius = 0;
+  queue[0][0] = source;
+  queue[1][0] = dest;
+  side[0][source] = side[1][dest] = 0;
+  size_t best = source == dest ? 0 : INT_MAX;
+  while (radius < best && radius < limit && head[0] < tail[0]
+         && head[1] < tail[1])
+    {
+      int s = tail[0] - head[0] > tail[1] - head[1];
+      unsigned int *mine = side[s], *other = side[!s];
+      for (size_t end = tail[s]; head[s] < end; head[s]++)
+        {
+          uint32_t u = queue[s][head[s]];
+          size_t d = mine[u] + 1;
+          const uint32_t *neighbors = board_neighbors (self, u);
+          for (size_t i = 0; i < board_degree (self, u); i++)
+            {
+              uint32_t w = neighbors[i];
+              if (mine[w] != INT_MAX)
+                continue;
+              if (other[w] != INT_MAX && d + other[w] < best)
+                best = d + other[w];
+              mine[w] = d;
+              queue[s][tail[s]++] = w;
+            }
+        }
+      radius++;
+    }
+  // Remise à l'infini des seuls sommets atteints
+  for (int s = 0; s < 2; s++)
+    for (size_t i = 0; i < tail[s]; i++)
+      side[s][queue[s][i]] = INT_MAX;
+  return best <= limit ? best : INT_MAX;
+}
+
+/*
+ * Dijkstra searches from both ends, the smaller heap popped first.
+ * Every vertex closer to an end than the last key popped on its side is
+ * settled, so a path not met yet is at least as long as the two last
+ * keys together; the search stops when they reach the best meeting
+ * found or exceed limit. A vertex whose lower bound to the other end
+ * shows it lies on no path short enough is not reached at all: with
+ * lengths, the searches settle many more vertices than the
+ * breadth-first ones and this halves their time, while it costs more
+ * than it saves without.
+ */
+static size_t bidirectional_dijkstra (const board *self, uint32_t source,
+                                      uint32_t dest, size_t limit)
+{
+  board_landmarks *marks = self->landmarks;
+  unsigned int *side[2] = { marks->forward, marks->backward };
+  uint32_t *reached[2] = { marks->queue, marks->queue + self->size };
+  const unsigned int *goal[2] = { marks->dist + dest * marks->count,
+    marks->dist + source * marks->count
+  };
+  size_t count[2] = { 1, 1 }, last[2] = { 0, 0 };
+  radix_heap heap[2];
+  memset (heap, 0, sizeof (heap));
+  reached[0][0] = source;
+  reached[1][0] = dest;
+  side[0][source] = side[1][dest] = 0;
+  size_t best = source == dest ? 0 : INT_MAX;
+  bool ok = radix_push (&heap[0], 0, source)
+    && radix_push (&heap[1], 0, dest);
+  uint64_t item;
+  while (ok && last[0] + last[1] < best && last[0] + last[1] <= limit
+         && heap[0].len > 0 && heap[1].len > 0)
+    {
+      int s = heap[0].len > heap[1].len;
+      unsigned int *mine = side[s], *other = side[!s];
+      if (!(ok = radix_pop (&heap[s], &item)))
+        break;
+      uint32_t u = item, d = item >> 32;
+      last[s] = d;
+      if (d > mine[u])
+        continue;
+      const uint32_t *neighbors = board_neighbors (self, u);
+      for (size_t i = 0; ok && i < board_degree (self, u); i++)
+        {
+          uint32_t w = neighbors[i], length = edge_length (self, u, i);
+          // Rencontre testée même sans amélioration, l'autre côté ayant
+          // pu atteindre w depuis
+          if (other[w] != INT_MAX && (size_t) d + length + other[w] < best)
+            best = (size_t) d + length + other[w];
+          if (d + length >= mine[w])
+            continue;
+          size_t bound = d + length + landmark_lower (marks, w, goal[s]);
+          if (bound >= best || bound > limit)
+            continue;
+          if (mine[w] == INT_MAX)
+            reached[s][count[s]++] = w;
+          mine[w] = d + length;
+          ok = radix_push (&heap[s], d + length, w);
+        }
+    }
+  for (int s = 0; s < 2; s++)
+    {
+      for (size_t i = 0; i < count[s]; i++)
+        side[s][reached[s][i]] = INT_MAX;
+      for (size_t b = 0; b < 33; b++)
+        free (heap[s].buckets[b].items);
+    }
+  return ok && best <= limit ? best : INT_MAX;
+}
+
+size_t board_dist_within (const board *self, size_t source, size_t dest,
+                          size_t limit)
+{
+  if (!self || source >= self->size || dest >= self->size)
+    return INT_MAX;
+  if (self->dist || self->dist_cache_bytes || !self->landmark_count)
+    {
+      size_t d = board_dist (self, source, dest);
+      return d <= limit ? d : INT_MAX;
+    }
+  if (!self->landmarks)
+    return INT_MAX;
+  size_t lower, upper;
+  landmark_bounds (self, source, dest, &lower, &upper);
+  if (lower > limit)
+    return INT_MAX;
+  if (lower == upper)
+    {
+      self->landmarks->bounded++;
+      return lower;
+    }
+  // Le plus court chemin est au plus upper : inutile de chercher au-delà
+  self->landmarks->searches++;
+  limit = upper < limit ? upper : limit;
+  return self->weights
+    ? bidirectional_dijkstra (self, source, dest, limit)
+    : bidirectional_bfs (self, source, dest, limit);
+}
+
+void board_dist_bounds (const board *self, size_t source, size_t dest,
+                        size_t *lower, size_t *upper)
+{
+  if (self && source < self->size && dest < self->size && !self->dist
+      && !self->dist_cache_bytes && self->landmark_count
+      && self->landmarks)
+    landmark_bounds (self, source, dest, lower, upper);
+  else
+    *lower = *upper = board_dist (self, source, dest);
+}
+
+uint64_t board_hash (const board *self)
+{
+  uint64_t hash = 0xcbf29ce484222325ULL ^ self->size;
+  size_t nadj = self->offsets[self->size];
+  const uint32_t *parts[] = { self->offsets, self->adj, self->weights };
+  size_t lens[] = { self->size + 1, nadj, self->weights ? nadj : 0 };
+  for (size_t p = 0; p < 3; p++)
+    for (size_t i = 0; i < lens[p]; i++)
+      hash = (hash ^ parts[p][i]) * 0x100000001b3ULL;
+  return hash ^ (self->weights != NULL);
+}
+
+static uint64_t tables_file_size (const board_tables_header *header)
+{
+  return sizeof (*header) + (header->dist_bytes + 63) / 64 * 64
+    + header->next_bytes;
+}
+
+/*
+ * Check that a tables header describes the tables of this graph in len
+ * bytes
+ */
+static bool tables_header_matches (const board *self,
+                                   const board_tables_header *header,
+                                   uint64_t hash, uint64_t len)
+{
+  size_t width = header->dist_width;
+  return len >= sizeof (*header)
+    && !memcmp (header->magic, BOARD_TABLES_MAGIC, sizeof (header->magic))
+    && header->version == BOARD_TABLES_VERSION && header->hash == hash
+    && header->size == self->size
+    && header->nadj == self->offsets[self->size]
+    && (width == 1 || width == 2 || width == 4)
+    && header->dist_bytes == self->dist_block[self->ncomps] * width
+    && header->next_width != 0
+    && header->next_bytes == self->comp_block[self->ncomps]
+    * header->next_width
+    && len == tables_file_size (header);
+}
+
+static void tables_header_fill (const board *self, uint64_t hash,
+                                board_tables_header *header)
+{
+  memset (header, 0, sizeof (*header));
+  memcpy (header->magic, BOARD_TABLES_MAGIC, sizeof (header->magic));
+  header->version = BOARD_TABLES_VERSION;
+  header->hash = hash;
+  header->size = self->size;
+  header->nadj = self->offsets[self->size];
+  header->dist_width = self->dist_width;
+  header->next_width = self->next_width;
+  header->dist_bytes = self->dist_block[self->ncomps] * self->dist_width;
+  header->next_bytes = self->comp_block[self->ncomps] * self->next_width;
+}
+
+/*
+ * Point dist and next into the len bytes of tables mapped at data
+ */
+static void board_use_tables (board *self, void *data, size_t len)
+{
+  const board_tables_header *header = data;
+  self->tables_map = data;
+  self->tables_map_len = len;
+  self->dist = (char *) data + sizeof (*header);
+  self->dist_width = header->dist_width;
+  self->next = (char *) data + sizeof (*header)
+    + (header->dist_bytes + 63) / 64 * 64;
+  self->next_width = header->next_width;
+}
+
+/*
+ * Map the tables file at path if it holds the tables of this graph
+ */
+static bool board_map_tables (board *self, const char *path, uint64_t hash)
+{
+  int fd = open (path, O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  board_tables_header header;
+  if (fstat (fd, &st) != 0 || (size_t) st.st_size < sizeof (header)
+      || read (fd, &header, sizeof (header)) != sizeof (header)
+      || !tables_header_matches (self, &header, hash, st.st_size))
+    {
+      close (fd);
+      return false;
+    }
+  void *data = mmap (NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close (fd);
+  if (data == MAP_FAILED)
+    return false;
+  board_use_tables (self, data, st.st_size);
+  return true;
+}
+
+/*
+ * Open a temporary file next to path, its name stored in tmp, renamed
+ * to path once complete so that no process ever maps a partial file
+ */
+static FILE *create_temp (const char *path, char **tmp)
+{
+  size_t len = strlen (path);
+  *tmp = malloc (len + 8);
+  if (!*tmp)
+    return NULL;
+  memcpy (*tmp, path, len);
+  memcpy (*tmp + len, ".XXXXXX", 8);
+  int fd = mkstemp (*tmp);
+  FILE *file = fd >= 0 && fchmod (fd, 0644) == 0 ? fdopen (fd, "wb") : NULL;
+  if (!file)
+    {
+      if (fd >= 0)
+        {
+          close (fd);
+          unlink (*tmp);
+        }
+      free (*tmp);
+    }
+  return file;
+}
+
+/*
+ * Close the temporary file and rename it to path if it was fully
+ * written, otherwise remove it
+ */
+static void commit_temp (FILE *file, char *tmp, const char *path, bool ok)
+{
+  ok = fclose (file) == 0 && ok;
+  if (!ok || rename (tmp, path) != 0)
+    unlink (tmp);
+  free (tmp);
+}
+
+/*
+ * Write the tables to path through a temporary file
+ */
+static void board_save_tables (const board *self, const char *path,
+                               uint64_t hash)
+{
+  board_tables_header header;
+  tables_header_fill (self, hash, &header);
+
+  char *tmp;
+  FILE *file = create_temp (path, &tmp);
+  if (!file)
+    return;
+  static const char zeros[64];
+  size_t pad = (header.dist_bytes + 63) / 64 * 64 - header.dist_bytes;
+  bool ok = fwrite (&header, sizeof (header), 1, file) == 1
+    && fwrite (self->dist, 1, header.dist_bytes, file) == header.dist_bytes
+    && fwrite (zeros, 1, pad, file) == pad
+    && fwrite (self->next, 1, header.next_bytes, file) == header.next_bytes;
+  commit_temp (file, tmp, path, ok);
+}
+
+/*
+ * Tables from dist_cache_dir, or computed and saved there
+ */
+static void board_dir_tables (board *self)
+{
+  uint64_t hash = board_hash (self);
+  size_t len = strlen (self->dist_cache_dir);
+  char *path = malloc (len + 32);
+  if (!path)
+    return;
+  snprintf (path, len + 32, "%s/%016llx.tables", self->dist_cache_dir,
+            (unsigned long long) hash);
+  if (!board_map_tables (self, path, hash))
+    {
+      board_all_pairs (self);
+      if (self->dist)
+        board_save_tables (self, path, hash);
+    }
+  free (path);
+}
+
+/*
+ * Hierarchy from hierarchy_file, or built and saved there
+ */
+static bool board_create_hierarchy (board *self)
+{
+  if (self->hierarchy)
+    return true;
+  if (self->size == 0 || !board_find_components (self))
+    return false;
+  self->hierarchy = malloc (sizeof (*self->hierarchy));
+  if (!self->hierarchy)
+    return false;
+  if (self->hierarchy_file
+      && hierarchy_read (self->hierarchy, self, self->hierarchy_file))
+    return true;
+  if (!hierarchy_build (self->hierarchy, self))
+    {
+      free (self->hierarchy);
+      self->hierarchy = NULL;
+      return false;
+    }
+  char *tmp;
+  FILE *file = self->hierarchy_file
+    ? create_temp (self->hierarchy_file, &tmp) : NULL;
+  if (file)
+    commit_temp (file, tmp, self->hierarchy_file,
+                 hierarchy_write (self->hierarchy, self, file));
+  return true;
+}
+
+size_t board_hierarchy_dist (const board *self, size_t source, size_t dest)
+{
+  if (!self || !self->hierarchy)
+    return INT_MAX;
+  return hierarchy_dist (self->hierarchy, source, dest, NULL);
+}
+
+/*
+ * Block-cut tree of the board, unless its blocks are too large
+ */
+static bool board_create_block_tree (board *self)
+{
+  if (self->block_tree)
+    return true;
+  if (self->size == 0 || !board_find_components (self))
+    return false;
+  self->block_tree = malloc (sizeof (*self->block_tree));
+  if (self->block_tree && block_tree_build (self->block_tree, self))
+    return true;
+  free (self->block_tree);
+  self->block_tree = NULL;
+  return false;
+}
+
+size_t board_block_dist (const board *self, size_t source, size_t dest)
+{
+  if (!self)
+    return INT_MAX;
+  if (self->block_tree)
+    return block_tree_dist (self->block_tree, source, dest, NULL);
+  // Blocs trop gros : board_prepare a calculé les tables complètes
+  return self->dist ? board_dist (self, source, dest) : INT_MAX;
+}
+
+/*
+ * Map a complete segment read-only, its header a second time writable
+ * for the reference count
+ */
+static bool board_attach_shm (board *self, int fd, size_t len)
+{
+  void *data = mmap (NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED)
+    return false;
+  void *header = mmap (NULL, sizeof (board_tables_header),
+                       PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (header == MAP_FAILED)
+    {
+      munmap (data, len);
+      return false;
+    }
+  board_use_tables (self, data, len);
+  self->tables_shared = header;
+  return true;
+}
+
+/*
+ * Copy the tables just computed into the new segment fd, counting this
+ * process, then mark it ready and use it instead of the private copy
+ */
+static bool board_publish_tables (board *self, int fd, uint64_t hash)
+{
+  board_tables_header header;
+  tables_header_fill (self, hash, &header);
+  header.refs = 1;
+  size_t len = tables_file_size (&header);
+  if (ftruncate (fd, len) != 0)
+    return false;
+  char *data = mmap (NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED)
+    return false;
+  memcpy (data, &header, sizeof (header));
+  memcpy (data + sizeof (header), self->dist, header.dist_bytes);
+  memcpy (data + sizeof (header) + (header.dist_bytes + 63) / 64 * 64,
+          self->next, header.next_bytes);
+  __atomic_store_n (&((board_tables_header *) data)->ready, 1,
+                    __ATOMIC_RELEASE);
+  munmap (data, len);
+
+  board_unmap_tables (self);
+  free (self->dist);
+  free (self->next);
+  self->dist = NULL;
+  self->next = NULL;
+  if (board_attach_shm (self, fd, len))
+    return true;
+  // Compté mais inutilisable : on se retire et on recalcule
+  board_tables_header *shared = mmap (NULL, sizeof (header),
+                                      PROT_READ | PROT_WRITE, MAP_SHARED,
+                                      fd, 0);
+  if (shared != MAP_FAILED)
+    {
+      tables_unref (shared);
+      munmap (shared, sizeof (header));
+    }
+  board_all_pairs (self);
+  return true;
+}
+
+/*
+ * Attach to the segment fd built by another process once it is ready.
+ * A segment still not ready after BOARD_SHM_WAIT_MS was left by a
+ * process that died building it: its name is removed so that the next
+ * process builds it again.
+ */
+static void board_join_tables (board *self, int fd, uint64_t hash,
+                               const char *name)
+{
+  struct stat st;
+  board_tables_header *header = MAP_FAILED;
+  for (size_t waited = 0; waited < BOARD_SHM_WAIT_MS; waited++)
+    {
+      if (header == MAP_FAILED && fstat (fd, &st) == 0
+          && (size_t) st.st_size >= sizeof (*header))
+        header = mmap (NULL, sizeof (*header), PROT_READ | PROT_WRITE,
+                       MAP_SHARED, fd, 0);
+      if (header != MAP_FAILED
+          && __atomic_load_n (&header->ready, __ATOMIC_ACQUIRE))
+        break;
+      struct timespec ms = { 0, 1000000 };
+      nanosleep (&ms, NULL);
+    }
+  if (header == MAP_FAILED || !__atomic_load_n (&header->ready,
+                                                __ATOMIC_ACQUIRE))
+    shm_unlink (name);
+  if (header == MAP_FAILED)
+    return;
+  // Segment déjà abandonné par tous : on calcule nos propres tables
+  if (__atomic_load_n (&header->ready, __ATOMIC_ACQUIRE)
+      && tables_header_matches (self, header, hash, st.st_size)
+      && tables_ref (header) && !board_attach_shm (self, fd, st.st_size))
+    tables_unref (header);
+  munmap (header, sizeof (*header));
+}
+
+/*
+ * Tables from a shared segment, built by the first process to create it
+ * and attached to by the others
+ */
+static void board_shared_tables (board *self)
+{
+  uint64_t hash = board_hash (self);
+  char name[64];
+  shm_name (name, sizeof (name), hash);
+  int fd = shm_open (name, O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (fd >= 0)
+    {
+      if (self->dist_cache_dir)
+        board_dir_tables (self);
+      if (!self->dist)
+        board_all_pairs (self);
+      // Sans tables publiées, les suivants ne doivent pas attendre
+      if (!self->dist || !board_publish_tables (self, fd, hash))
+        shm_unlink (name);
+      close (fd);
+    }
+  else if (errno == EEXIST && (fd = shm_open (name, O_RDWR, 0)) >= 0)
+    {
+      board_join_tables (self, fd, hash, name);
+      close (fd);
+    }
+}
+
+bool board_prepare (board *self)
+{
+  if (!self || !board_find_components (self)
+      || !board_index_adjacency (self))
+    return false;
+  if (!self->dist && self->dist_cache_bytes)
+    return board_create_row_cache (self);
+  if (!self->dist && self->landmark_count)
+    return board_create_landmarks (self);
+  if (!self->dist && self->contract)
+    return board_create_hierarchy (self);
+  if (!self->dist && self->blocks && board_create_block_tree (self))
+    return true;
+  if (!self->dist && self->share_tables)
+    board_shared_tables (self);
+  if (!self->dist && self->dist_cache_dir)
+    board_dir_tables (self);
+  if (!self->dist)
+    board_all_pairs (self);
+  return self->dist != NULL;
+}
+
+typedef struct
+{
+  board *b;
+  size_t first;
+  size_t step;
+  bool ok;
+} bfs_share;
+
+/*
+ * Breadth-first searches from sources first, first + step, ... Along
+ * with the distances, top[v] - 1 is the smallest possible largest
+ * interior vertex of a shortest path to v (0 when v is a neighbor of
+ * the source). Floyd-Warshall last improves (source, v) when that
+ * vertex w becomes allowed, taking the next vertex towards w: doing
+ * the same keeps next identical.
+ */
+static void *bfs_sources (void *arg)
+{
+  bfs_share *share = arg;
+  board *b = share->b;
+  uint32_t *queue = malloc (b->size * sizeof (*queue));
+  uint32_t *top = malloc (b->size * sizeof (*top));
+  uint32_t *hop = malloc (b->size * sizeof (*hop));
+  unsigned int *dist = malloc (b->size * sizeof (*dist));
+  share->ok = queue && top && hop && dist;
+  for (size_t s = share->first; share->ok && s < b->size; s += share->step)
+    {
+      uint32_t c = b->comp[s];
+      size_t n = b->comp_start[c + 1] - b->comp_start[c];
+      const uint32_t *members = b->comp_members + b->comp_start[c];
+      for (size_t i = 0; i < n; i++)
+        top[members[i]] = UINT32_MAX;
+
+      size_t head = 0, tail = 0;
+      queue[tail++] = s;
+      dist[b->comp_pos[s]] = 0;
+      hop[b->comp_pos[s]] = UINT32_MAX;
+      top[s] = 0;
+      while (head < tail)
+        {
+          uint32_t u = queue[head++];
+          size_t pos = b->comp_pos[u];
+          // Tous les prédécesseurs de u sont traités avant lui
+          if (u != s && top[u] != 0)
+            hop[pos] = hop[b->comp_pos[top[u] - 1]];
+          uint32_t via = u == s ? 0 : (top[u] > u + 1 ? top[u] : u + 1);
+          const uint32_t *neighbors = board_neighbors (b, u);
+          for (size_t i = 0; i < board_degree (b, u); i++)
+            {
+              uint32_t v = neighbors[i];
+              if (top[v] == UINT32_MAX)
+                {
+                  top[v] = via;
+                  dist[b->comp_pos[v]] = dist[pos] + 1;
+                  queue[tail++] = v;
+                  // Case du voisin dans la liste de la source
+                  if (u == s)
+                    hop[b->comp_pos[v]] = i;
+                }
+              else if (v != s && dist[b->comp_pos[v]] == dist[pos] + 1
+                       && via < top[v])
+                top[v] = via;
+            }
+        }
+      // Seule la fin de la ligne est dans le triangle
+      dist_store_row (b, dist_row_cell (b, c, b->comp_pos[s]),
+                      dist + b->comp_pos[s], n - b->comp_pos[s]);
+      if (b->next)
+        next_store_row (b, b->comp_block[c] + b->comp_pos[s] * n, hop, n);
+    }
+  free (queue);
+  free (top);
+  free (hop);
+  free (dist);
+  return NULL;
+}
+
+/*
+ * Run work on units first, first + step, ... of nunits, on several
+ * threads, and drop the tables if one of them ran out of memory
+ */
+static void board_run_apsp (board *self, void *(*work) (void *),
+                            size_t nunits)
+{
+  size_t nthreads = thread_count (BOARD_APSP_THREADS);
+  if (nthreads > nunits)
+    nthreads = nunits ? nunits : 1;
+  bfs_share shares[BOARD_APSP_THREADS];
+  pthread_t threads[BOARD_APSP_THREADS];
+  size_t started = 1;
+  for (size_t t = 0; t < nthreads; t++)
+    {
+      shares[t].b = self;
+      shares[t].first = t;
+      shares[t].step = nthreads;
+    }
+  for (; started < nthreads; started++)
+    if (pthread_create (&threads[started], NULL, work,
+                        &shares[started]) != 0)
+      break;
+  work (&shares[0]);
+  // Parts dont le thread n'a pas pu être créé
+  for (size_t t = started; t < nthreads; t++)
+    work (&shares[t]);
+  bool ok = shares[0].ok;
+  for (size_t t = 1; t < nthreads; t++)
+    {
+      if (t < started)
+        pthread_join (threads[t], NULL);
+      ok = ok && shares[t].ok;
+    }
+  if (!ok)
+    {
+      free (self->dist);
+      free (self->next);
+      self->dist = NULL;
+      self->next = NULL;
+    }
+}
+
+void board_BFS_all_pairs (board *self)
+{
+  if (self && self->weights)
+    board_delta_stepping_all_pairs (self);
+  else if (board_alloc_tables (self))
+    board_run_apsp (self, bfs_sources, self->size);
+}
+
+/*
+ * Fill the next row of source s from its distances dist, with the rule
+ * of bfs_sources: vertices are taken by increasing distance (counting
+ * sort, radix sort with weights) and each one looks at its neighbors
+ * one edge closer
+ */
+static void next_from_dist (board *b, uint32_t s, const unsigned int *dist,
+                            uint32_t *order, uint32_t *count, uint32_t *top)
+{
+  uint32_t c = b->comp[s];
+  size_t n = b->comp_start[c + 1] - b->comp_start[c];
+  const uint32_t *members = b->comp_members + b->comp_start[c];
+
+  if (b->weights)
+    {
+      // Octet par octet, count servant de second tableau
+      unsigned int longest = 0;
+      for (size_t i = 0; i < n; i++)
+        {
+          order[i] = i;
+          longest = dist[i] > longest ? dist[i] : longest;
+        }
+      uint32_t *from = order, *to = count;
+      for (unsigned int shift = 0; shift < 32 && longest >> shift;
+           shift += 8)
+        {
+          uint32_t digits[257] = { 0 };
+          for (size_t i = 0; i < n; i++)
+            digits[((dist[from[i]] >> shift) & 255) + 1]++;
+          for (size_t d = 0; d < 256; d++)
+            digits[d + 1] += digits[d];
+          for (size_t i = 0; i < n; i++)
+            to[digits[(dist[from[i]] >> shift) & 255]++] = from[i];
+          uint32_t *tmp = from;
+          from = to;
+          to = tmp;
+        }
+      if (from != order)
+        memcpy (order, from, n * sizeof (*order));
+    }
+  else
+    {
+      memset (count, 0, (n + 1) * sizeof (*count));
+      for (size_t i = 0; i < n; i++)
+        count[dist[i] + 1]++;
+      for (size_t d = 0; d < n; d++)
+        count[d + 1] += count[d];
+      for (size_t i = 0; i < n; i++)
+        order[count[dist[i]]++] = i;
+    }
+
+  // count, libre une fois trié, reçoit les cases, d'abord celles des
+  // voisins de s en gardant la première de chacun
+  uint32_t *hop = count;
+  const uint32_t *first = board_neighbors (b, s);
+  for (size_t j = board_degree (b, s); j-- > 0;)
+    hop[b->comp_pos[first[j]]] = j;
+  hop[b->comp_pos[s]] = UINT32_MAX;
+  top[b->comp_pos[s]] = 0;
+  for (size_t k = 1; k < n; k++)
+    {
+      uint32_t i = order[k], v = members[i], best = UINT32_MAX;
+      const uint32_t *neighbors = board_neighbors (b, v);
+      for (size_t j = 0; j < board_degree (b, v); j++)
+        {
+          uint32_t p = b->comp_pos[neighbors[j]];
+          if (dist[p] + edge_length (b, v, j) != dist[i])
+            continue;
+          uint32_t via = neighbors[j] == s ? 0
+            : (top[p] > neighbors[j] + 1 ? top[p] : neighbors[j] + 1);
+          best = via < best ? via : best;
+        }
+      top[i] = best;
+      if (best != 0)
+        hop[i] = hop[b->comp_pos[best - 1]];
+    }
+  next_store_row (b, b->comp_block[c] + b->comp_pos[s] * n, hop, n);
+}
+
+/*
+ * Multi-source searches on batches of BOARD_MSBFS_LANES sources of a
+ * component, batches being numbered across components. Bit l of the
+ * words of a vertex stands for source l of the batch: a vertex enters
+ * the frontier of every source that reaches one of its neighbors
+ * first, for all the sources at once.
+ */
+static void *msbfs_batches (void *arg)
+{
+  bfs_share *share = arg;
+  board *b = share->b;
+  size_t n = b->size, words = BOARD_MSBFS_LANES / 64;
+  uint64_t *bits = malloc (3 * n * words * sizeof (*bits));
+  uint32_t *order = malloc ((3 * n + 1) * sizeof (*order));
+  unsigned int *row = malloc (n * sizeof (*row));
+  share->ok = bits && order && row;
+  uint64_t *seen = bits, *frontier = bits + n * words;
+  uint64_t *reached = bits + 2 * n * words;
+  uint32_t *count = order + n, *top = order + 2 * n + 1;
+  size_t batch = 0;
+  for (size_t c = 0; share->ok && c < b->ncomps; c++)
+    {
+      size_t size = b->comp_start[c + 1] - b->comp_start[c];
+      const uint32_t *members = b->comp_members + b->comp_start[c];
+      for (size_t start = 0; start < size;
+           start += BOARD_MSBFS_LANES, batch++)
+        {
+          if (batch % share->step != share->first)
+            continue;
+          size_t lanes = size - start < BOARD_MSBFS_LANES
+            ? size - start : BOARD_MSBFS_LANES;
+          uint64_t full[BOARD_MSBFS_LANES / 64];
+          for (size_t w = 0; w < words; w++)
+            full[w] = lanes >= 64 * (w + 1) ? UINT64_MAX
+              : (lanes <= 64 * w ? 0 : ((uint64_t) 1 << (lanes % 64)) - 1);
+          memset (seen, 0, size * words * sizeof (*seen));
+          memset (frontier, 0, size * words * sizeof (*frontier));
+          for (size_t l = 0; l < lanes; l++)
+            {
+              size_t i = start + l;
+              seen[i * words + l / 64] |= (uint64_t) 1 << (l % 64);
+              frontier[i * words + l / 64] |= (uint64_t) 1 << (l % 64);
+              dist_store (b, dist_row_cell (b, c, i), 0);
+            }
+          for (unsigned int d = 1;; d++)
+            {
+              bool any = false;
+              for (size_t i = 0; i < size; i++)
+                {
+                  uint64_t *out = reached + i * words;
+                  const uint32_t *neighbors = board_neighbors (b, members[i]);
+                  bool done = true;
+                  for (size_t w = 0; w < words; w++)
+                    {
+                      out[w] = 0;
+                      done = done && seen[i * words + w] == full[w];
+                    }
+                  // Déjà atteint depuis toutes les sources du lot
+                  if (done)
+                    continue;
+                  for (size_t j = 0; j < board_degree (b, members[i]); j++)
+                    {
+                      const uint64_t *in = frontier
+                        + b->comp_pos[neighbors[j]] * words;
+                      for (size_t w = 0; w < words; w++)
+                        out[w] |= in[w];
+                    }
+                  for (size_t w = 0; w < words; w++)
+                    {
+                      out[w] &= ~seen[i * words + w];
+                      for (uint64_t new = out[w]; new; new &= new - 1)
+                        {
+                          size_t l = w * 64 + __builtin_ctzll (new);
+                          if (start + l < i)
+                            dist_store (b, dist_row_cell (b, c, start + l)
+                                        + i - start - l, d);
+                        }
+                      any = any || out[w];
+                    }
+                }
+              if (!any)
+                break;
+              for (size_t k = 0; k < size * words; k++)
+                seen[k] |= reached[k];
+              uint64_t *tmp = frontier;
+              frontier = reached;
+              reached = tmp;
+            }
+          for (size_t l = 0; b->next && l < lanes; l++)
+            {
+              dist_gather (b, c, start + l, row, NULL);
+              next_from_dist (b, members[start + l], row, order, count, top);
+            }
+        }
+    }
+  free (bits);
+  free (order);
+  free (row);
+  return NULL;
+}
+
+void board_MS_BFS_all_pairs (board *self)
+{
+  if (self && self->weights)
+    {
+      board_delta_stepping_all_pairs (self);
+      return;
+    }
+  if (!board_alloc_tables (self))
+    return;
+  size_t batches = 0;
+  for (size_t c = 0; c < self->ncomps; c++)
+    batches += (self->comp_start[c + 1] - self->comp_start[c]
+                + BOARD_MSBFS_LANES - 1) / BOARD_MSBFS_LANES;
+  board_run_apsp (self, msbfs_batches, batches);
+}
+
+/*
+ * Tiled Floyd-Warshall: a component is padded to a multiple of the
+ * tile size in a 64-byte aligned matrix of int32_t where BOARD_FW_INF
+ * stands for unreachable, so that adding two of them cannot overflow
+ */
+static void minplus_row_scalar (int32_t *c, const int32_t *b, int32_t a,
+                                size_t len)
+{
+  for (size_t j = 0; j < len; j++)
+    c[j] = a + b[j] < c[j] ? a + b[j] : c[j];
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+static void minplus_row_sse2 (int32_t *c, const int32_t *b, int32_t a,
+                              size_t len)
+{
+  __m128i va = _mm_set1_epi32 (a);
+  for (size_t j = 0; j < len; j += 4)
+    {
+      __m128i vc = _mm_load_si128 ((const __m128i *) (c + j));
+      __m128i sum = _mm_add_epi32 (va,
+                                   _mm_load_si128 ((const __m128i *) (b + j)));
+      // Pas de minimum 32 bits en SSE2 : comparaison puis sélection
+      __m128i less = _mm_cmpgt_epi32 (vc, sum);
+      _mm_store_si128 ((__m128i *) (c + j),
+                       _mm_or_si128 (_mm_and_si128 (less, sum),
+                                     _mm_andnot_si128 (less, vc)));
+    }
+}
+
+__attribute__ ((target ("avx2")))
+static void minplus_row_avx2 (int32_t *c, const int32_t *b, int32_t a,
+                              size_t len)
+{
+  __m256i va = _mm256_set1_epi32 (a);
+  for (size_t j = 0; j < len; j += 8)
+    {
+      __m256i vc = _mm256_load_si256 ((const __m256i *) (c + j));
+      __m256i vb = _mm256_load_si256 ((const __m256i *) (b + j));
+      _mm256_store_si256 ((__m256i *) (c + j),
+                          _mm256_min_epi32 (vc, _mm256_add_epi32 (va, vb)));
+    }
+}
+#endif
+
+typedef void (*minplus_row) (int32_t *, const int32_t *, int32_t, size_t);
+
+typedef struct
+{
+  int32_t *m;
+  size_t stride;
+  size_t tiles;
+  size_t k;
+  bool cross;
+  minplus_row row;
+  size_t first;
+  size_t step;
+} fw_share;
+
+/*
+ * Relax tile (ti, tj) through the vertices of tile tk, which may be
+ * the same tile: k stays the outer loop as in the plain algorithm
+ */
+static void fw_tile (const fw_share *share, size_t ti, size_t tj, size_t tk)
+{
+  size_t stride = share->stride;
+  int32_t *c = share->m + ti * BOARD_FW_TILE * stride + tj * BOARD_FW_TILE;
+  const int32_t *a =
+    share->m + ti * BOARD_FW_TILE * stride + tk * BOARD_FW_TILE;
+  const int32_t *b =
+    share->m + tk * BOARD_FW_TILE * stride + tj * BOARD_FW_TILE;
+  for (size_t k = 0; k < BOARD_FW_TILE; k++)
+    for (size_t i = 0; i < BOARD_FW_TILE; i++)
+      if (a[i * stride + k] < BOARD_FW_INF)
+        share->row (c + i * stride, b + k * stride, a[i * stride + k],
+                    BOARD_FW_TILE);
+}
+
+/*
+ * Tiles first, first + step, ... of the row and column of tile k
+ * (cross), or of the rest of the matrix
+ */
+static void *fw_tiles (void *arg)
+{
+  const fw_share *share = arg;
+  size_t t = share->tiles, k = share->k;
+  size_t units = share->cross ? 2 * (t - 1) : (t - 1) * (t - 1);
+  for (size_t u = share->first; u < units; u += share->step)
+    {
+      if (share->cross)
+        {
+          size_t other = u / 2 < k ? u / 2 : u / 2 + 1;
+          if (u % 2 == 0)
+            fw_tile (share, k, other, k);
+          else
+            fw_tile (share, other, k, k);
+        }
+      else
+        {
+          size_t i = u / (t - 1), j = u % (t - 1);
+          fw_tile (share, i < k ? i : i + 1, j < k ? j : j + 1, k);
+        }
+    }
+  return NULL;
+}
+
+static void fw_phase (fw_share *base, bool cross)
+{
+  size_t units = cross ? 2 * (base->tiles - 1)
+    : (base->tiles - 1) * (base->tiles - 1);
+  size_t nthreads = thread_count (BOARD_APSP_THREADS);
+  if (nthreads > units)
+    nthreads = units;
+  fw_share shares[BOARD_APSP_THREADS];
+  pthread_t threads[BOARD_APSP_THREADS];
+  size_t started = 1;
+  for (size_t t = 0; t < nthreads; t++)
+    {
+      shares[t] = *base;
+      shares[t].cross = cross;
+      shares[t].first = t;
+      shares[t].step = nthreads;
+    }
+  for (; started < nthreads; started++)
+    if (pthread_create (&threads[started], NULL, fw_tiles,
+                        &shares[started]) != 0)
+      break;
+  if (nthreads > 0)
+    fw_tiles (&shares[0]);
+  for (size_t t = started; t < nthreads; t++)
+    fw_tiles (&shares[t]);
+  for (size_t t = 1; t < started; t++)
+    pthread_join (threads[t], NULL);
+}
+
+/*
+ * Distances of component c by tiled Floyd-Warshall, copied to its block
+ */
+static bool fw_component (board *self, size_t c, minplus_row row)
+{
+  size_t n = self->comp_start[c + 1] - self->comp_start[c];
+  size_t tiles = (n + BOARD_FW_TILE - 1) / BOARD_FW_TILE;
+  // Une ligne de 64 octets en plus évite les puissances de deux, dont
+  // les lignes d'une tuile tomberaient dans les mêmes ensembles du cache
+  size_t rows = tiles * BOARD_FW_TILE, stride = rows + 16;
+  const uint32_t *members = self->comp_members + self->comp_start[c];
+  void *memory;
+  if (posix_memalign (&memory, 64, rows * stride * sizeof (int32_t)))
+    return false;
+  int32_t *m = memory;
+  for (size_t i = 0; i < rows * stride; i++)
+    m[i] = BOARD_FW_INF;
+  for (size_t u = 0; u < n; u++)
+    {
+      const uint32_t *neighbors = board_neighbors (self, members[u]);
+      for (size_t i = 0; i < board_degree (self, members[u]); i++)
+        {
+          // La plus courte des arêtes en double
+          int32_t *cell = &m[u * stride + self->comp_pos[neighbors[i]]];
+          int32_t length = edge_length (self, members[u], i);
+          *cell = length < *cell ? length : *cell;
+        }
+    }
+  for (size_t v = 0; v < rows; v++)
+    m[v * stride + v] = 0;
+
+  // Tuile diagonale, puis sa ligne et sa colonne, puis le reste
+  fw_share share;
+  share.m = m;
+  share.stride = stride;
+  share.tiles = tiles;
+  share.row = row;
+  for (share.k = 0; share.k < tiles; share.k++)
+    {
+      fw_tile (&share, share.k, share.k, share.k);
+      if (tiles > 1)
+        {
+          fw_phase (&share, true);
+          fw_phase (&share, false);
+        }
+    }
+
+  for (size_t u = 0; u < n; u++)
+    dist_store_row (self, dist_row_cell (self, c, u),
+                    (const unsigned int *) (m + u * stride + u), n - u);
+  free (memory);
+  return true;
+}
+
+/*
+ * next of sources first, first + step, ... from the distances
+ */
+static void *next_sources (void *arg)
+{
+  bfs_share *share = arg;
+  board *b = share->b;
+  uint32_t *order = malloc ((3 * b->size + 1) * sizeof (*order));
+  unsigned int *row = malloc (b->size * sizeof (*row));
+  share->ok = order && row;
+  for (size_t s = share->first; share->ok && s < b->size; s += share->step)
+    {
+      dist_gather (b, b->comp[s], b->comp_pos[s], row, NULL);
+      next_from_dist (b, s, row, order, order + b->size,
+                      order + 2 * b->size + 1);
+    }
+  free (order);
+  free (row);
+  return NULL;
+}
+
+/*
+ * Mean length of the edges, the bucket width of delta-stepping, and
+ * length of the longest one
+ */
+static void board_weight_range (const board *self, uint32_t *mean,
+                                uint32_t *longest)
+{
+  size_t nadj = self->offsets[self->size];
+  uint64_t total = 0;
+  *longest = 1;
+  for (size_t i = 0; self->weights && i < nadj; i++)
+    {
+      total += self->weights[i];
+      *longest = self->weights[i] > *longest ? self->weights[i] : *longest;
+    }
+  *mean = self->weights && nadj ? total / nadj : 1;
+}
+
+void board_Floyd_Warshall (board *self)
+{
+  if (!self || !board_find_components (self))
+    return;
+  if (self->weights)
+    {
+      uint32_t mean, longest;
+      board_weight_range (self, &mean, &longest);
+      size_t largest = 0;
+      for (size_t c = 0; c < self->ncomps; c++)
+        if (self->comp_start[c + 1] - self->comp_start[c] > largest)
+          largest = self->comp_start[c + 1] - self->comp_start[c];
+      // Un plus court chemin a moins de largest arêtes
+      if ((uint64_t) longest * largest >= BOARD_FW_INF)
+        {
+          board_delta_stepping_all_pairs (self);
+          return;
+        }
+    }
+  if (!board_alloc_tables (self))
+    return;
+  minplus_row row = minplus_row_scalar;
+#if defined(__x86_64__) || defined(__i386__)
+  row = __builtin_cpu_supports ("avx2") ? minplus_row_avx2
+    : minplus_row_sse2;
+#endif
+  for (size_t c = 0; c < self->ncomps; c++)
+    if (!fw_component (self, c, row))
+      {
+        free (self->dist);
+        free (self->next);
+        self->dist = NULL;
+        self->next = NULL;
+        return;
+      }
+  if (self->next)
+    board_run_apsp (self, next_sources, self->size);
+}
+
+typedef struct
+{
+  uint32_t *items;
+  size_t len;
+  size_t capacity;
+} vertex_list;
+
+static bool vertex_list_push (vertex_list *list, uint32_t v)
+{
+  if (list->len == list->capacity)
+    {
+      size_t capacity = list->capacity ? 2 * list->capacity : 16;
+      uint32_t *items = realloc (list->items, capacity * sizeof (*items));
+      if (!items)
+        return false;
+      list->items = items;
+      list->capacity = capacity;
+    }
+  list->items[list->len++] = v;
+  return true;
+}
+
+/*
+ * Delta-stepping search of one source: bucket k holds the vertices at
+ * tentative distance [k delta, (k + 1) delta). No edge reaches further
+ * than nbuckets - 1 buckets ahead, so nbuckets lists are used in turn.
+ * Positions are those of the component, dist being a row of it.
+ */
+typedef struct
+{
+  const board *b;
+  unsigned int *dist;
+  const uint32_t *members;
+  uint32_t delta;
+  size_t nbuckets;
+  vertex_list *buckets;
+  vertex_list settled;
+  bool *marked;
+  size_t pending;
+} delta_search;
+
+/*
+ * Relax the light (no longer than delta) or heavy edges of position i
+ */
+static bool delta_relax (delta_search *search, uint32_t i, bool light)
+{
+  const board *b = search->b;
+  uint32_t v = search->members[i];
+  const uint32_t *neighbors = board_neighbors (b, v);
+  for (size_t j = 0; j < board_degree (b, v); j++)
+    {
+      uint32_t length = edge_length (b, v, j);
+      if ((length <= search->delta) != light)
+        continue;
+      uint32_t p = b->comp_pos[neighbors[j]];
+      unsigned int d = search->dist[i] + length;
+      if (d >= search->dist[p])
+        continue;
+      search->dist[p] = d;
+      if (!vertex_list_push (&search->buckets[d / search->delta
+                                              % search->nbuckets], p))
+        return false;
+      search->pending++;
+    }
+  return true;
+}
+
+static bool delta_stepping (delta_search *search, uint32_t s)
+{
+  const board *b = search->b;
+  uint32_t c = b->comp[s];
+  size_t n = b->comp_start[c + 1] - b->comp_start[c];
+  search->members = b->comp_members + b->comp_start[c];
+  for (size_t i = 0; i < n; i++)
+    search->dist[i] = UINT_MAX;
+  search->dist[b->comp_pos[s]] = 0;
+  if (!vertex_list_push (&search->buckets[0], b->comp_pos[s]))
+    return false;
+  search->pending = 1;
+  for (size_t k = 0; search->pending > 0; k++)
+    {
+      // Arêtes légères jusqu'à ce que le seau reste vide
+      vertex_list *bucket = &search->buckets[k % search->nbuckets];
+      search->settled.len = 0;
+      while (bucket->len > 0)
+        {
+          uint32_t i = bucket->items[--bucket->len];
+          search->pending--;
+          // Entrée périmée : le sommet a été rapproché depuis
+          if (search->dist[i] / search->delta != k)
+            continue;
+          if (!search->marked[i])
+            {
+              search->marked[i] = true;
+              if (!vertex_list_push (&search->settled, i))
+                return false;
+            }
+          if (!delta_relax (search, i, true))
+            return false;
+        }
+      // Puis une seule fois les arêtes lourdes des sommets fixés
+      for (size_t j = 0; j < search->settled.len; j++)
+        {
+          search->marked[search->settled.items[j]] = false;
+          if (!delta_relax (search, search->settled.items[j], false))
+            return false;
+        }
+    }
+  return true;
+}
+
+/*
+ * Delta-stepping searches from sources first, first + step, ..., next
+ * being derived from each dist row
+ */
+static void *delta_sources (void *arg)
+{
+  bfs_share *share = arg;
+  board *b = share->b;
+  delta_search search;
+  uint32_t longest;
+  board_weight_range (b, &search.delta, &longest);
+  search.b = b;
+  search.nbuckets = longest / search.delta + 2;
+  search.buckets = calloc (search.nbuckets, sizeof (*search.buckets));
+  search.settled.items = NULL;
+  search.settled.len = 0;
+  search.settled.capacity = 0;
+  search.marked = calloc (b->size, sizeof (*search.marked));
+  search.dist = malloc (b->size * sizeof (*search.dist));
+  uint32_t *order = malloc ((3 * b->size + 1) * sizeof (*order));
+  share->ok = search.buckets && search.marked && search.dist && order;
+  for (size_t s = share->first; share->ok && s < b->size; s += share->step)
+    {
+      share->ok = delta_stepping (&search, s);
+      if (!share->ok)
+        break;
+      uint32_t c = b->comp[s], i = b->comp_pos[s];
+      size_t n = b->comp_start[c + 1] - b->comp_start[c];
+      dist_store_row (b, dist_row_cell (b, c, i), search.dist + i, n - i);
+      if (b->next)
+        next_from_dist (b, s, search.dist, order, order + b->size,
+                        order + 2 * b->size + 1);
+    }
+  for (size_t k = 0; search.buckets && k < search.nbuckets; k++)
+    free (search.buckets[k].items);
+  free (search.buckets);
+  free (search.settled.items);
+  free (search.marked);
+  free (search.dist);
+  free (order);
+  return NULL;
+}
+
+void board_delta_stepping_all_pairs (board *self)
+{
+  if (board_alloc_tables (self))
+    board_run_apsp (self, delta_sources, self->size);
+}
+
+void board_all_pairs (board *self)
+{
+  if (!self)
+    return;
+  switch (self->apsp)
+    {
+    case BOARD_APSP_MSBFS:
+      board_MS_BFS_all_pairs (self);
+      break;
+    case BOARD_APSP_FLOYD_WARSHALL:
+      board_Floyd_Warshall (self);
+      break;
+    case BOARD_APSP_DELTA_STEPPING:
+      board_delta_stepping_all_pairs (self);
+      break;
+    default:
+      board_BFS_all_pairs (self);
+    }
+}
+
+bool board_dist_row (const board *self, size_t source, unsigned int *row)
+{
+  if (!self || !row || source >= self->size)
+    return false;
+  if (!self->dist && self->dist_cache_bytes)
+    {
+      const void *cached = self->row_cache
+        ? row_cache_row ((board *) self, source) : NULL;
+      for (size_t v = 0; cached && v < self->size; v++)
+        row[v] = dist_load (cached, self->dist_width, v);
+      return cached != NULL;
+    }
+  if (!self->dist && self->landmark_count)
+    return self->landmarks
+      && single_source (self, source, row, self->landmarks->queue);
+  if (!self->dist && (self->contract || self->block_tree))
+    {
+      // Parcours complet, la hiérarchie et les blocs ne servant qu'aux
+      // paires
+      uint32_t *queue = malloc (self->size * sizeof (*queue));
+      bool ok = queue && single_source (self, source, row, queue);
+      free (queue);
+      return ok;
+    }
+  if (!self->dist)
+    return false;
+  for (size_t v = 0; v < self->size; v++)
+    row[v] = INT_MAX;
+  uint32_t c = self->comp[source];
+  dist_gather (self, c, self->comp_pos[source], row,
+               self->comp_members + self->comp_start[c]);
+  return true;
+}
+
+/*
+ * First neighbor of source on a shortest path to dest, from the
+ * distances alone
+ */
+static size_t next_from_neighbors (const board *self, size_t source,
+                                   size_t dest)
+{
+  size_t d = board_dist (self, source, dest);
+  if (source == dest || d == INT_MAX)
+    return source == dest ? source : INT_MAX;
+  const uint32_t *neighbors = board_neighbors (self, source);
+  for (size_t i = 0; i < board_degree (self, source); i++)
+    {
+      // Inutile de chercher plus loin que d - length
+      size_t length = edge_length (self, source, i);
+      if (length <= d && board_dist_within (self, neighbors[i], dest,
+                                            d - length) == d - length)
+        return neighbors[i];
+    }
+  return INT_MAX;
+}
+
+size_t board_next (const board *self, size_t source, size_t dest)
+{
+  if (!self)
+    return 0;
+  if (!self->dist && (self->dist_cache_bytes || self->landmark_count))
+    return next_from_neighbors (self, source, dest);
+  if (!self->dist && self->contract)
+    {
+      size_t next = INT_MAX;
+      if (self->hierarchy)
+        hierarchy_dist (self->hierarchy, source, dest, &next);
+      return next;
+    }
+  if (!self->dist && self->block_tree)
+    {
+      size_t next;
+      block_tree_dist (self->block_tree, source, dest, &next);
+      return next;
+    }
+  if (!self->dist || !self->next)
+    return INT_MAX;
+  size_t cell = board_cell (self, source, dest);
+  if (cell == (size_t) -1)
+    return INT_MAX;
+  uint32_t slot = next_load (self, cell);
+  return slot == UINT32_MAX ? source : board_neighbors (self, source)[slot];
+}
+
+/*
+ * Lower bound on the number of edges between u and v: no edge covers
+ * more than max_edge. None with weights, which need not follow the
+ * coordinates.
+ */
+static uint32_t board_hops_bound (const board *self, size_t u, size_t v)
+{
+  if (!self->x || !(self->max_edge > 0) || self->weights)
+    return 0;
+  double dx = (double) self->x[u] - self->x[v];
+  double dy = (double) self->y[u] - self->y[v];
+  double hops = ceil (sqrt (dx * dx + dy * dy) / self->max_edge - 1e-3);
+  return hops > 0 ? (hops < self->size ? hops : self->size) : 0;
+}
+
+static void heap_push (uint64_t *heap, size_t *len, uint64_t key)
+{
+  size_t i = (*len)++;
+  for (; i > 0 && heap[(i - 1) / 2] > key; i = (i - 1) / 2)
+    heap[i] = heap[(i - 1) / 2];
+  heap[i] = key;
+}
+
+static uint64_t heap_pop (uint64_t *heap, size_t *len)
+{
+  uint64_t top = heap[0], last = heap[--(*len)];
+  size_t i = 0;
+  for (size_t c; (c = 2 * i + 1) < *len; i = c)
+    {
+      if (c + 1 < *len && heap[c + 1] < heap[c])
+        c++;
+      if (last <= heap[c])
+        break;
+      heap[i] = heap[c];
+    }
+  heap[i] = last;
+  return top;
+}
+
+size_t board_astar (const board *self, size_t source, size_t dest,
+                    size_t *next)
+{
+  if (!self || !self->offsets || source >= self->size
+      || dest >= self->size || (self->comp
+                                && self->comp[source] != self->comp[dest]))
+    return INT_MAX;
+  if (source == dest)
+    {
+      if (next)
+        *next = source;
+      return 0;
+    }
+  size_t n = self->size, capacity = self->offsets[n] + 1, len = 0;
+  uint32_t *g = malloc (n * sizeof (*g));
+  uint32_t *parent = malloc (n * sizeof (*parent));
+  uint64_t *heap = malloc (capacity * sizeof (*heap));
+  size_t result = INT_MAX;
+  if (!g || !parent || !heap)
+    goto end;
+  for (size_t v = 0; v < n; v++)
+    g[v] = UINT32_MAX;
+
+  // Recherche depuis dest : le père de source est le prochain sommet
+  g[dest] = 0;
+  heap_push (heap, &len, (uint64_t) board_hops_bound (self, dest, source)
+             << 32 | dest);
+  while (len > 0)
+    {
+      uint64_t top = heap_pop (heap, &len);
+      uint32_t u = top, f = top >> 32;
+      if (f > g[u] + board_hops_bound (self, u, source))
+        continue;
+      if (u == source)
+        {
+          result = g[u];
+          if (next)
+            *next = parent[u];
+          break;
+        }
+      const uint32_t *neighbors = board_neighbors (self, u);
+      for (size_t i = 0; i < board_degree (self, u); i++)
+        {
+          uint32_t w = neighbors[i], length = edge_length (self, u, i);
+          if (g[u] + length >= g[w])
+            continue;
+          g[w] = g[u] + length;
+          parent[w] = u;
+          // Borne non monotone à cause des arrondis : rare, on agrandit
+          if (len == capacity)
+            {
+              uint64_t *bigger = realloc (heap, 2 * capacity * sizeof (*heap));
+              if (!bigger)
+                goto end;
+              heap = bigger;
+              capacity *= 2;
+            }
+          heap_push (heap, &len, (uint64_t) (g[w]
+                                             + board_hops_bound (self, w,
+                                                                 source))
+                     << 32 | w);
+        }
     }
-  /* if (self->next[source][dest] == UINT_MAX) { */
-  /*      return -1; */
-  /* } */
-  return self->next[source][dest];
+end:
+  free (g);
+  free (parent);
+  free (heap);
+  return result;
 }
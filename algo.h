@@ -1,29 +1,200 @@
 #ifndef ALGO_H
 #define ALGO_H
 
+#include <limits.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 
 enum role
 { COPS, ROBBERS };
 
-typedef struct sboard_vertex
+/*
+ * Algorithm computing dist and next, all giving the same tables
+ */
+enum board_apsp
+{ BOARD_APSP_BFS, BOARD_APSP_MSBFS, BOARD_APSP_FLOYD_WARSHALL,
+  BOARD_APSP_DELTA_STEPPING
+};
+
+/*
+ * Edge lengths are stored in units of 1 / BOARD_WEIGHT_SCALE, between 1
+ * and BOARD_WEIGHT_MAX; a longer edge makes a map invalid
+ */
+#define BOARD_WEIGHT_SCALE 10000
+#define BOARD_WEIGHT_MAX (1 << 24)
+
+/*
+ * Distance rows from single sources, computed on demand: row k holds
+ * the distances from source[k] on dist_width bytes like dist, and
+ * slot[v] is the row of v, UINT32_MAX if it has none. newer and older
+ * chain the used rows from newest, the last one read, to oldest, the
+ * first one evicted when all the rows are used.
+ */
+typedef struct
 {
-  size_t index;
-  size_t degree;
-  struct sboard_vertex **neighbors;
-  bool *optim;
-} board_vertex;
+  size_t rows;
+  size_t used;
+  uint32_t *source;
+  uint32_t *slot;
+  uint32_t *newer;
+  uint32_t *older;
+  uint32_t newest;
+  uint32_t oldest;
+  void *dist;
+  unsigned int *scratch;
+  size_t hits;
+  size_t misses;
+} board_row_cache;
 
+/*
+ * Landmarks for the distances without tables: vertex[k] is the k-th
+ * landmark and dist[v * count + k] its distance to v, INT_MAX if v is
+ * not connected to it. forward and backward, INT_MAX between queries,
+ * and queue are the scratch arrays of the bidirectional searches.
+ * bounded counts the queries settled by the bounds alone and searches
+ * the others.
+ */
+typedef struct
+{
+  size_t count;
+  uint32_t *vertex;
+  unsigned int *dist;
+  unsigned int *forward;
+  unsigned int *backward;
+  uint32_t *queue;
+  size_t bounded;
+  size_t searches;
+} board_landmarks;
+
+struct hierarchy;
+struct block_tree;
+
+/*
+ * Vertices are identified by their index, 0 .. size - 1.
+ *
+ * The adjacency is stored in compressed sparse row form: the neighbors
+ * of vertex v are adj[offsets[v]] .. adj[offsets[v + 1] - 1], in the
+ * order the edges appear in the file. offsets and adj share a single
+ * allocation owned by offsets, or point into map when the board comes
+ * from a binary file.
+ *
+ * Vertex v belongs to connected component comp[v], whose vertices are
+ * comp_members[comp_start[c]] .. comp_members[comp_start[c + 1] - 1]
+ * in increasing order, v being the comp_pos[v]-th of them. dist and
+ * next only hold one block per component; vertices of different
+ * components are unreachable. The block of c in next is dense and
+ * starts at comp_block[c]; rather than a vertex, the entry of (u, v)
+ * is the slot k of the next vertex among the neighbors of u,
+ * adj[offsets[u] + k], on next_width bytes: 1 while no vertex has 255
+ * neighbors, else 2 or 4, the largest value standing for u itself.
+ * Distances being symmetric, the block of c in dist only holds the
+ * upper triangle, row by row: the entry of positions i <= j starts at
+ * dist_block[c] + i (2 n - i - 1) / 2 + j for a component of n
+ * vertices, so that row i holds j = i .. n - 1.
+ * dist is a single 64-byte aligned buffer of dist_width-byte entries,
+ * 1, 2 or 4, the smallest width holding an upper bound on the diameter
+ * measured before the tables are filled; the largest value of the
+ * width stands for unreachable.
+ *
+ * Vertex v lies at (x[v], y[v]) and no edge is longer than max_edge. x
+ * and y share a single allocation owned by x, or point into map; they
+ * are NULL when a vertex line of the file does not hold two numbers.
+ *
+ * When weighted is set before loading, the edge to adj[i] has length
+ * weights[i] and distances add up lengths instead of counting edges.
+ * weights is NULL for a board of unit edges, otherwise it has its own
+ * allocation or points into map.
+ *
+ * When dist_cache_bytes is set before board_prepare, dist and next
+ * are never computed: distances come from single-source rows kept in
+ * row_cache, at most dist_cache_bytes of them, and next is the first
+ * neighbor of u found one edge closer with these distances, which may
+ * break ties differently from the tables.
+ *
+ * When landmark_count is set before board_prepare instead, dist and
+ * next are not computed either: landmarks holds the distances from
+ * that many vertices chosen by farthest-point selection, O(k n) memory.
+ * They bound the distance of any pair by the triangle inequality, and
+ * a bidirectional search that cannot go beyond the upper bound gives
+ * the exact distance when the bounds differ.
+ *
+ * When contract is set before board_prepare instead, distances and
+ * next vertices come from a contraction hierarchy, O(n + shortcuts)
+ * memory, read from hierarchy_file if that file holds the hierarchy of
+ * this graph, otherwise built and saved there when it is set.
+ *
+ * When blocks is set before board_prepare instead, block_tree holds
+ * the biconnected components of the graph, the distances inside each
+ * of them and the tree they form, O(n) memory for a tree and constant
+ * time queries through the lowest common ancestor of two vertices. If
+ * the blocks would hold more than a quarter of the full tables, they
+ * are dropped and the full tables computed as usual.
+ *
+ * When dist_cache_dir is set, board_prepare looks there for the tables
+ * of a graph with the same hash and maps them read-only instead of
+ * computing them, or saves them there once computed. tables_map and
+ * tables_map_len then describe the mapping that dist and next point
+ * into.
+ *
+ * When share_tables is set, board_prepare publishes the tables in a
+ * POSIX shared memory segment named after the hash of the graph: the
+ * first process to create it computes the tables, the others wait for
+ * it to be ready and map it read-only, tables_shared being their view
+ * of its reference count. The last process detached removes it. A
+ * process killed while attached never detaches: its segment stays,
+ * still valid and attached to by later processes on the same graph,
+ * until it is removed by hand (rm /dev/shm/crdt-* under Linux) while
+ * no process uses it.
+ */
 typedef struct
 {
   size_t size;
-  board_vertex **vertices;
+  uint32_t *offsets;
+  uint32_t *adj;
+  uint32_t *weights;
+  uint64_t *adj_bits;
+  uint32_t *adj_sorted;
+  bool adj_indexed;
+  bool simplify;
+  bool weighted;
+  size_t removed_edges;
+  void *map;
+  size_t map_len;
+  uint32_t *order;
+  uint32_t *rank;
+  enum board_apsp apsp;
+  float *x;
+  float *y;
+  float max_edge;
   size_t cops;
   size_t robbers;
   size_t max_turn;
-  unsigned int **dist;
-  size_t **next;
+  size_t ncomps;
+  uint32_t *comp;
+  uint32_t *comp_pos;
+  uint32_t *comp_start;
+  uint32_t *comp_members;
+  size_t *comp_block;
+  size_t *dist_block;
+  void *dist;
+  size_t dist_width;
+  void *next;
+  size_t next_width;
+  size_t dist_cache_bytes;
+  board_row_cache *row_cache;
+  size_t landmark_count;
+  board_landmarks *landmarks;
+  bool contract;
+  const char *hierarchy_file;
+  struct hierarchy *hierarchy;
+  bool blocks;
+  struct block_tree *block_tree;
+  const char *dist_cache_dir;
+  void *tables_map;
+  size_t tables_map_len;
+  bool share_tables;
+  void *tables_shared;
 } board;
 
 /*
@@ -33,36 +204,352 @@ void board_create (board * self);
 
 /*
  * Create board from parsing a file and return false if file is
- * incorrect
+ * incorrect. If self->simplify is set beforehand, self-loops and
+ * duplicate edges are dropped and their number is stored in
+ * self->removed_edges, each neighbor keeping the place of its first
+ * edge in the file and the length of the shortest one. If
+ * self->weighted is set, a third number on an edge line is the length
+ * of the edge, the Euclidean distance between its ends by default (1
+ * without coordinates); a negative length is an error, and so is a
+ * board whose shortest paths could reach INT_MAX units, the distance
+ * of vertices that are not connected.
  */
 bool board_read_from (board * self, FILE * file);
 
+/*
+ * Same as board_read_from on the file named filename, which is mapped
+ * in memory instead of being read through a FILE
+ */
+bool board_load (board * self, const char *filename);
+
+/*
+ * Binary map format, in native byte order: a 64-byte header followed
+ * by the size + 1 offsets and the adjacency of the CSR, all uint32_t,
+ * then with BOARD_BINARY_COORDS the size x and the size y coordinates
+ * as floats, then with BOARD_BINARY_WEIGHTS the weights of the
+ * adjacency. Version 1 files have no coordinates and are still read.
+ */
+#define BOARD_BINARY_MAGIC "CRBD"
+#define BOARD_BINARY_VERSION 2
+#define BOARD_BINARY_SIMPLIFIED 1       /* no duplicate, as with simplify */
+#define BOARD_BINARY_COORDS 2   /* coordinates after the adjacency */
+#define BOARD_BINARY_WEIGHTS 4  /* weights after the coordinates */
+
+typedef struct
+{
+  char magic[4];
+  uint32_t version;
+  uint64_t cops;
+  uint64_t robbers;
+  uint64_t max_turn;
+  uint64_t size;
+  uint64_t nadj;
+  uint32_t flags;
+  float max_edge;
+  uint32_t reserved[2];
+} board_binary_header;
+
+/*
+ * Write a loaded board in the binary map format and return false on
+ * write error or if the board was reordered
+ */
+bool board_write_binary (board * self, FILE * file);
+
+/*
+ * Create board by mapping a binary map file, used in place once its
+ * offsets and neighbors are checked. The weights are only used if
+ * self->weighted is set, and a weighted board cannot be read from a
+ * file without weights; they are checked like the lengths of a text
+ * file. Return false, leaving self untouched, if the file is not a
+ * valid binary map.
+ */
+bool board_read_binary (board * self, const char *filename);
+
 /*
  * Destroy a board by freeing all memory used by its members
  */
 void board_destroy (board * self);
 
+/*
+ * Return the number of neighbors of vertex v
+ */
+static inline size_t board_degree (const board * self, size_t v)
+{
+  return self->offsets[v + 1] - self->offsets[v];
+}
+
+/*
+ * Return the contiguous array of the board_degree(self, v) neighbors
+ * of vertex v
+ */
+static inline const uint32_t *board_neighbors (const board * self, size_t v)
+{
+  return self->adj + self->offsets[v];
+}
+
+/*
+ * Renumber the vertices in Reverse Cuthill-McKee order so that
+ * neighbors get close indices and the rows of the distance tables they
+ * read are close in memory. Afterwards every index used by the board is
+ * internal: order[v] is the file index of internal vertex v and rank
+ * the inverse permutation. Tables computed before are dropped.
+ */
+bool board_reorder (board * self);
+
+/*
+ * Return the file index of internal vertex v
+ */
+static inline size_t board_external_index (const board * self, size_t v)
+{
+  return self->order ? self->order[v] : v;
+}
+
+/*
+ * Return the internal index of file vertex v
+ */
+static inline size_t board_internal_index (const board * self, size_t v)
+{
+  return self->rank ? self->rank[v] : v;
+}
+
+/*
+ * Maps with at most this many vertices answer adjacency queries from a
+ * packed size x size bitset (2 MB at the limit), larger ones from a
+ * sorted copy of each neighbor row, or from adj itself when its rows
+ * are already sorted; adj_indexed tells that one of them was built
+ */
+#define BOARD_ADJ_BITSET_MAX 4096
+
+/*
+ * Build the structure used by board_is_valid_move, called by
+ * board_prepare; without it board_is_valid_move scans the neighbors
+ */
+bool board_index_adjacency (board * self);
+
 /*
  * Check if there is an edge between source and destination
  */
-bool board_is_valid_move (board * self, size_t source, size_t dest);
+bool board_is_valid_move (const board * self, size_t source, size_t dest);
 
 /*
- * Floyd-Warshall algorithm to determine the smallest number of edges
- * from any vertex to any other vertex
+ * Compute everything the queries below need (components, adjacency
+ * index, distances), which they never build themselves. Once it
+ * returned true the board is only read and can be shared by any number
+ * of games or threads; per-game state lives with the caller. With
+ * dist_cache_bytes set, only the row cache is created and distance
+ * queries keep updating it, so the board is no longer shared between
+ * threads; the same goes for landmark_count and contract, whose
+ * searches use scratch arrays of the board; blocks leaves it
+ * read-only. Return false if memory is missing.
+ */
+bool board_prepare (board * self);
+
+/*
+ * Hash of the graph, lengths included, naming its tables file
+ */
+uint64_t board_hash (const board * self);
+
+/*
+ * Compute the connected components, done when the board is loaded
+ */
+bool board_find_components (board * self);
+
+/*
+ * Floyd-Warshall algorithm to determine the shortest distance from any
+ * vertex to any other vertex. The distances are computed on
+ * cache-sized tiles with SSE2 or AVX2 when available, the tiles of a
+ * round being spread over several threads; next is then derived from
+ * them with the choice the plain triple loop would have made. Weighted
+ * boards whose distances could overflow the tiles are handed to
+ * board_delta_stepping_all_pairs.
  */
 void board_Floyd_Warshall (board * self);
 
 /*
- * Return shortest number of edges between vertex source and vertex
- * dest
+ * Same tables as board_Floyd_Warshall, next included, computed by one
+ * breadth-first search per source spread over several threads, in
+ * O(size * edges) instead of O(size^3). Only for unit edges, weighted
+ * boards being handed to board_delta_stepping_all_pairs.
+ */
+void board_BFS_all_pairs (board * self);
+
+/*
+ * Same tables again, the distances coming from breadth-first searches
+ * run for many sources at once with one bit per source, and next
+ * being derived from them. Only for unit edges as well.
+ */
+void board_MS_BFS_all_pairs (board * self);
+
+/*
+ * Same tables for any weights, by one delta-stepping search per source
+ * (buckets of distances as wide as the mean edge, edges no longer than
+ * that relaxed within a bucket), sources spread over several threads
+ */
+void board_delta_stepping_all_pairs (board * self);
+
+/*
+ * Compute dist and next with the algorithm chosen by self->apsp, set
+ * before board_prepare (breadth-first search by default). Weighted
+ * boards use delta-stepping unless Floyd-Warshall is asked for.
+ */
+void board_all_pairs (board * self);
+
+/*
+ * Single-source distances without the tables: Dijkstra's algorithm with
+ * a radix heap. dist receives size distances, INT_MAX for the vertices
+ * not connected to source. Return false if memory is missing.
+ */
+bool board_dijkstra (const board * self, size_t source, unsigned int *dist);
+
+/*
+ * board_dist for a board with dist_cache_bytes set, once board_prepare
+ * has created the cache: the distance is read in the row of source if
+ * it is cached, otherwise in the row of dest, computed if needed;
+ * callers should pass the end that stays the same across queries, a
+ * token or a target, as dest
+ */
+size_t board_cached_dist (const board * self, size_t source, size_t dest);
+
+/*
+ * board_dist for a board with contract set, from the hierarchy built by
+ * board_prepare
+ */
+size_t board_hierarchy_dist (const board * self, size_t source,
+                             size_t dest);
+
+/*
+ * board_dist for a board with blocks set, from the block-cut tree built
+ * by board_prepare, or from the full tables if the blocks were too
+ * large
  */
-size_t board_dist (board * self, size_t source, size_t dest);
+size_t board_block_dist (const board * self, size_t source, size_t dest);
+
+/*
+ * Distance between source and dest if it is at most limit, INT_MAX if
+ * it is larger or they are not connected. With landmarks, the search
+ * stops as soon as no path of at most limit can be left.
+ */
+size_t board_dist_within (const board * self, size_t source, size_t dest,
+                          size_t limit);
+
+/*
+ * Store in lower and upper bounds on the distance between source and
+ * dest: the distance itself with tables, the triangle inequality over
+ * the landmarks otherwise, upper being INT_MAX when none lies in their
+ * component. Both are INT_MAX if they are not connected.
+ */
+void board_dist_bounds (const board * self, size_t source, size_t dest,
+                        size_t *lower, size_t *upper);
+
+/*
+ * Position of the couple (source, dest) in the block of their
+ * component in next, or -1 if they are not connected
+ */
+static inline size_t board_cell (const board * self, size_t source,
+                                 size_t dest)
+{
+  uint32_t c = self->comp[source];
+  if (c != self->comp[dest])
+    return (size_t) -1;
+  size_t n = self->comp_start[c + 1] - self->comp_start[c];
+  return self->comp_block[c] + self->comp_pos[source] * n
+    + self->comp_pos[dest];
+}
+
+/*
+ * Position of the couple (source, dest), in either order, in the
+ * triangle of their component in dist, or -1 if they are not connected.
+ * The smaller and larger positions are selected without branches.
+ */
+static inline size_t board_dist_cell (const board * self, size_t source,
+                                      size_t dest)
+{
+  uint32_t c = self->comp[source];
+  if (c != self->comp[dest])
+    return (size_t) -1;
+  size_t n = self->comp_start[c + 1] - self->comp_start[c];
+  size_t i = self->comp_pos[source], j = self->comp_pos[dest];
+  size_t low = j ^ ((i ^ j) & -(size_t) (i < j)), high = i ^ j ^ low;
+  return self->dist_block[c] + low * (2 * n - low - 1) / 2 + high;
+}
+
+/*
+ * Return the entry of dist at position cell, INT_MAX for unreachable
+ */
+static inline size_t board_dist_entry (const board * self, size_t cell)
+{
+  if (self->dist_width == 1)
+    {
+      uint8_t d = ((const uint8_t *) self->dist)[cell];
+      return d == UINT8_MAX ? INT_MAX : d;
+    }
+  if (self->dist_width == 2)
+    {
+      uint16_t d = ((const uint16_t *) self->dist)[cell];
+      return d == UINT16_MAX ? INT_MAX : d;
+    }
+  uint32_t d = ((const uint32_t *) self->dist)[cell];
+  return d == UINT32_MAX ? INT_MAX : d;
+}
+
+/*
+ * Return shortest distance between vertex source and vertex dest (the
+ * number of edges, or the length with weights), INT_MAX if they are not
+ * connected or if board_prepare has not built the tables or the
+ * structure of the chosen mode. Inline so that the loops over distances
+ * of the strategies only pay for the read.
+ */
+static inline size_t board_dist (const board * self, size_t source,
+                                 size_t dest)
+{
+  if (!self)
+    return 0;
+  if (!self->dist)
+    {
+      // Lignes à la demande, sans table
+      if (self->dist_cache_bytes)
+        return board_cached_dist (self, source, dest);
+      // Repères et recherche bidirectionnelle, sans table non plus
+      if (self->landmark_count)
+        return board_dist_within (self, source, dest, INT_MAX);
+      if (self->contract)
+        return board_hierarchy_dist (self, source, dest);
+      // Blocs et plus proche ancêtre commun, sauf blocs trop gros
+      if (self->blocks)
+        return board_block_dist (self, source, dest);
+      // board_prepare n'a pas été appelé : rien n'est construit ici
+      return INT_MAX;
+    }
+  size_t cell = board_dist_cell (self, source, dest);
+  return cell == (size_t) -1 ? INT_MAX : board_dist_entry (self, cell);
+}
+
+/*
+ * Store in row the distances from vertex source to every vertex, as
+ * board_dist would return them, reading the part of the triangle that
+ * is contiguous at once. For loops over all the vertices. Return false
+ * if board_prepare has not built the tables or if memory is missing.
+ */
+bool board_dist_row (const board * self, size_t source, unsigned int *row);
 
 /*
  * Return next vertex on shortest path from vertex source to vertex
- * dest
+ * dest, source itself if they are equal and INT_MAX if they are not
+ * connected or if board_prepare has not been called
+ */
+size_t board_next (const board * self, size_t source, size_t dest);
+
+/*
+ * Single-pair query that needs no distance table: A* search from dest
+ * towards source, guided by the straight-line distance to source
+ * divided by max_edge, a lower bound on the number of edges left.
+ * Return the length of a shortest path, INT_MAX if source and dest are
+ * not connected, and if next is not NULL store there a neighbor of
+ * source on such a path (source itself if source == dest). Without
+ * coordinates, or with weights that need not follow them, the search
+ * is a plain Dijkstra search.
  */
-size_t board_next (board * self, size_t source, size_t dest);
+size_t board_astar (const board * self, size_t source, size_t dest,
+                    size_t *next);
 
 #endif // ALGO_H
@@ -1,8 +1,17 @@
+#define _DEFAULT_SOURCE
 #include "algo.h"
+#include "blocks.h"
+#include "hierarchy.h"
+#include "kernel.h"
+#include "symmetry.h"
 
+#include <dirent.h>
 #include <limits.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
 #define mu_assert(message, test)                                               \
 	do {                                                                       \
@@ -34,12 +43,15 @@ static char *test_board_Floyd_Warshall_chain ()
 
   bool read = board_read_from (&b, file);
   mu_assert ("error, failure reading board", read == true);
+  mu_assert ("error, failure preparing board", board_prepare (&b));
   mu_assert ("error, incorrect distance",
              board_dist (&b, 0, 0) == 0 && board_dist (&b, 0, 1) == 1 &&
              board_dist (&b, 0, 2) == 2 && board_dist (&b, 1, 2) == 1);
   mu_assert ("error, incorrect next vertex",
              board_next (&b, 0, 0) == 0 && board_next (&b, 0, 1) == 1 &&
              board_next (&b, 0, 2) == 1 && board_next (&b, 1, 2) == 2);
+  mu_assert ("error, incorrect distance width", b.dist_width == 1);
+  mu_assert ("error, incorrect next width", b.next_width == 1);
 
   board_destroy (&b);
 
@@ -59,6 +71,7 @@ static char *test_board_single_node ()
 
   bool read = board_read_from (&b, file);
   mu_assert ("Lecture échouée (1 nœud)", read == true);
+  mu_assert ("Préparation échouée (1 nœud)", board_prepare (&b));
   mu_assert ("Taille incorrecte", b.size == 1);
   mu_assert ("Distance 0->0 invalide", board_dist (&b, 0, 0) == 0);
   mu_assert ("Next 0->0 invalide", board_next (&b, 0, 0) == 0);
@@ -82,6 +95,7 @@ static char *test_board_two_nodes_disconnected ()
 
   bool read = board_read_from (&b, file);
   mu_assert ("Lecture échouée (2 nœuds)", read == true);
+  mu_assert ("Préparation échouée (2 nœuds)", board_prepare (&b));
   mu_assert ("Distance 0->1 devrait être INT_MAX",
              board_dist (&b, 0, 1) == (size_t) INT_MAX);
   mu_assert ("Déplacement 0->1 invalide", !board_is_valid_move (&b, 0, 1));
@@ -103,6 +117,7 @@ static char *test_board_triangle ()
 
   bool read = board_read_from (&b, file);
   mu_assert ("Lecture échouée (triangle)", read == true);
+  mu_assert ("Préparation échouée (triangle)", board_prepare (&b));
 
   // Vérification des distances
   for (size_t i = 0; i < 3; i++)
@@ -144,6 +159,7 @@ static char *test_board_multiple_paths ()
 
   bool read = board_read_from (&b, file);
   mu_assert ("Lecture échouée (chemins multiples)", read == true);
+  mu_assert ("Préparation échouée (chemins multiples)", board_prepare (&b));
 
   mu_assert ("Distance 0->3 incorrecte", board_dist (&b, 0, 3) == 2);
   mu_assert ("Next 0->3 devrait être 1", board_next (&b, 0, 3) == 1);
@@ -292,6 +308,1246 @@ static char *test_board_read_from_valid_autoedge ()
   return NULL;
 }
 
+static char *test_board_valid_move_large ()
+{
+  board b;
+  board_create (&b);
+
+  // Étoile au-delà du seuil du bitset : le centre a un très grand degré
+  size_t n = BOARD_ADJ_BITSET_MAX + 100;
+  FILE *file = tmpfile ();
+  fprintf (file, "Cops: 1\nRobbers: 1\nMax turn: 1\nVertices: %zu\n", n);
+  for (size_t i = 0; i < n; i++)
+    fputs ("0 0\n", file);
+  fprintf (file, "Edges: %zu\n", n - 2);
+  for (size_t i = n - 1; i > 1; i--)
+    fprintf (file, "0 %zu\n", i);
+  rewind (file);
+
+  bool read = board_read_from (&b, file);
+  mu_assert ("Lecture échouée (étoile)", read == true);
+  mu_assert ("Arête centre->feuille absente", board_is_valid_move (&b, 0, 7)
+             && board_is_valid_move (&b, 0, n - 1)
+             && board_is_valid_move (&b, 2, 0));
+  mu_assert ("Arête 0->1 inexistante acceptée",
+             !board_is_valid_move (&b, 0, 1)
+             && !board_is_valid_move (&b, 1, 0));
+  mu_assert ("Arête feuille->feuille acceptée",
+             !board_is_valid_move (&b, 2, 3));
+  mu_assert ("Indexation échouée", board_index_adjacency (&b));
+  mu_assert ("Index trié attendu", b.adj_sorted && !b.adj_bits);
+  mu_assert ("Arête absente après indexation",
+             board_is_valid_move (&b, 0, n - 1)
+             && !board_is_valid_move (&b, 0, 1));
+
+  board_destroy (&b);
+  fclose (file);
+  return NULL;
+}
+
+static char *test_board_read_from_simplify ()
+{
+  board b;
+  board_create (&b);
+  b.simplify = true;
+
+  // Doublons dans les deux sens et boucle sur 0
+  char data[] = "Cops: 1\nRobbers: 1\nMax turn: 1\n"
+    "Vertices: 3\n0 0\n0 0\n0 0\n" "Edges: 5\n0 2\n0 1\n2 0\n0 0\n0 2\n";
+  FILE *file = tmpfile ();
+  fputs (data, file);
+  rewind (file);
+
+  bool read = board_read_from (&b, file);
+  mu_assert ("Lecture échouée (simplification)", read == true);
+  mu_assert ("Nombre d'arêtes supprimées incorrect", b.removed_edges == 3);
+  mu_assert ("Degrés incorrects", board_degree (&b, 0) == 2
+             && board_degree (&b, 1) == 1 && board_degree (&b, 2) == 1);
+  mu_assert ("Ordre du fichier perdu", board_neighbors (&b, 0)[0] == 2
+             && board_neighbors (&b, 0)[1] == 1);
+  mu_assert ("Déplacements incorrects", board_is_valid_move (&b, 0, 0)
+             && board_is_valid_move (&b, 2, 0)
+             && !board_is_valid_move (&b, 1, 2));
+  board_destroy (&b);
+  fclose (file);
+
+  // Le doublon le plus court garde la place du premier
+  board_create (&b);
+  b.simplify = b.weighted = true;
+  file = tmpfile ();
+  fputs ("Cops: 1\nRobbers: 1\nMax turn: 1\nVertices: 3\n0 0\n0 0\n0 0\n"
+         "Edges: 3\n0 2 3\n0 1 1\n2 0 2\n", file);
+  rewind (file);
+  mu_assert ("Lecture échouée (doublons pondérés)", board_read_from (&b, file)
+             && board_prepare (&b));
+  mu_assert ("Doublon pondéré incorrect", b.removed_edges == 1
+             && board_neighbors (&b, 0)[0] == 2
+             && board_dist (&b, 0, 2) == 2 * BOARD_WEIGHT_SCALE);
+  board_destroy (&b);
+  fclose (file);
+  return NULL;
+}
+
+static char *test_board_read_from_long_lines ()
+{
+  board b;
+  board_create (&b);
+
+  // Ligne de coordonnées bien plus longue que l'ancien tampon de 128 octets
+  FILE *file = tmpfile ();
+  fputs ("Cops: 1\r\nRobbers: 1\nMax turn: 1\nVertices: 2\n", file);
+  for (size_t i = 0; i < 50; i++)
+    fputs ("0.123456 ", file);
+  fputs ("\n1 1\nEdges: 1\n1 0\r\n", file);
+  rewind (file);
+
+  bool read = board_read_from (&b, file);
+  mu_assert ("Lecture échouée (ligne longue)", read == true);
+  mu_assert ("Arête absente", board_is_valid_move (&b, 0, 1));
+
+  board_destroy (&b);
+  fclose (file);
+  return NULL;
+}
+
+static char *test_board_binary_round_trip ()
+{
+  board b, copy;
+  board_create (&b);
+  board_create (&copy);
+  b.simplify = true;
+
+  char data[] = "Cops: 2\nRobbers: 3\nMax turn: 4\n"
+    "Vertices: 4\n0 0\n1 0\n0 -1.5\n1e0 -15E-1\n"
+    "Edges: 4\n0 1\n0 2\n1 3\n2 3\n";
+  FILE *file = tmpfile ();
+  fputs (data, file);
+  rewind (file);
+  mu_assert ("Lecture échouée (binaire)", board_read_from (&b, file));
+  fclose (file);
+
+  char name[] = "/tmp/algo_testsXXXXXX";
+  int fd = mkstemp (name);
+  file = fd >= 0 ? fdopen (fd, "w+b") : NULL;
+  mu_assert ("Écriture binaire échouée", file
+             && board_write_binary (&b, file) && fflush (file) == 0);
+  bool read = board_read_binary (&copy, name);
+  mu_assert ("Relecture binaire échouée", read == true
+             && board_prepare (&copy));
+  mu_assert ("En-tête incorrect", copy.cops == 2 && copy.robbers == 3
+             && copy.max_turn == 4 && copy.size == 4 && copy.simplify);
+  for (size_t v = 0; v < b.size; v++)
+    for (size_t i = 0; i < board_degree (&b, v); i++)
+      mu_assert ("Adjacence différente", board_degree (&copy, v)
+                 == board_degree (&b, v) && board_neighbors (&copy, v)[i]
+                 == board_neighbors (&b, v)[i]);
+  mu_assert ("Distance 0->3 incorrecte", board_dist (&copy, 0, 3) == 2);
+  mu_assert ("Coordonnées perdues", copy.x && copy.x[3] == 1.0f
+             && copy.y[3] == -1.5f && copy.max_edge == b.max_edge
+             && b.max_edge >= 1.5f && b.max_edge < 1.501f);
+
+  // Voisin hors du plateau dans un fichier corrompu
+  uint32_t outside = b.size;
+  board corrupt;
+  board_create (&corrupt);
+  mu_assert ("Corruption impossible",
+             fseek (file, sizeof (board_binary_header)
+                    + (b.size + 1) * sizeof (uint32_t), SEEK_SET) == 0
+             && fwrite (&outside, sizeof (outside), 1, file) == 1
+             && fflush (file) == 0);
+  mu_assert ("Voisin hors du plateau accepté",
+             !board_read_binary (&corrupt, name));
+  board_destroy (&corrupt);
+
+  // Un fichier texte n'est pas binaire
+  rewind (file);
+  mu_assert ("Réécriture impossible", ftruncate (fd, 0) == 0
+             && fputs (data, file) >= 0 && fflush (file) == 0);
+  mu_assert ("Un fichier texte n'est pas binaire",
+             !board_read_binary (&b, name));
+  fclose (file);
+  remove (name);
+
+  board_destroy (&b);
+  board_destroy (&copy);
+  return NULL;
+}
+
+static char *test_board_reorder ()
+{
+  board b;
+  board_create (&b);
+
+  // Chaîne 0-3-1-4-2 numérotée dans le désordre
+  char data[] = "Cops: 1\nRobbers: 1\nMax turn: 1\n"
+    "Vertices: 5\n0 0\n0 0\n0 0\n0 0\n0 0\n"
+    "Edges: 4\n0 3\n3 1\n1 4\n4 2\n";
+  FILE *file = tmpfile ();
+  fputs (data, file);
+  rewind (file);
+
+  bool read = board_read_from (&b, file);
+  mu_assert ("Lecture échouée (renumérotation)", read == true);
+  mu_assert ("Renumérotation échouée", board_reorder (&b)
+             && board_prepare (&b));
+  for (size_t v = 0; v < b.size; v++)
+    mu_assert ("Permutation incorrecte",
+               board_internal_index (&b, board_external_index (&b, v)) == v);
+  // Sur une chaîne, l'ordre RCM donne des voisins consécutifs
+  for (size_t v = 0; v + 1 < b.size; v++)
+    mu_assert ("Voisins non consécutifs", board_is_valid_move (&b, v, v + 1));
+  size_t a = board_internal_index (&b, 0), c = board_internal_index (&b, 2);
+  mu_assert ("Distance 0->2 incorrecte", board_dist (&b, a, c) == 4);
+
+  board_destroy (&b);
+  fclose (file);
+  return NULL;
+}
+
+/*
+ * Compare every distance of a prepared board with the chain formula
+ */
+static void *check_chain_distances (void *arg)
+{
+  const board *b = arg;
+  for (size_t u = 0; u < b->size; u++)
+    for (size_t v = 0; v < b->size; v++)
+      if (board_dist (b, u, v) != (u > v ? u - v : v - u)
+          || !board_is_valid_move (b, u, u + (u + 1 < b->size)))
+        return "wrong";
+  return NULL;
+}
+
+static char *test_board_prepare_shared ()
+{
+  board b;
+  board_create (&b);
+
+  FILE *file = tmpfile ();
+  fputs ("Cops: 1\nRobbers: 1\nMax turn: 1\nVertices: 50\n", file);
+  for (size_t i = 0; i < 50; i++)
+    fputs ("0 0\n", file);
+  fputs ("Edges: 49\n", file);
+  for (size_t i = 0; i < 49; i++)
+    fprintf (file, "%zu %zu\n", i, i + 1);
+  rewind (file);
+
+  mu_assert ("Lecture échouée (partage)", board_read_from (&b, file));
+  mu_assert ("Préparation échouée", board_prepare (&b) && b.dist && b.next);
+
+  // Plusieurs threads lisent le même plateau préparé
+  pthread_t threads[4];
+  for (size_t t = 0; t < 4; t++)
+    pthread_create (&threads[t], NULL, check_chain_distances, &b);
+  bool ok = true;
+  for (size_t t = 0; t < 4; t++)
+    {
+      void *result;
+      pthread_join (threads[t], &result);
+      ok = ok && result == NULL;
+    }
+  mu_assert ("Distances incorrectes depuis un thread", ok);
+
+  board_destroy (&b);
+  fclose (file);
+  return NULL;
+}
+
+/*
+ * A* on a 10 x 10 grid with unit spacing, whose last vertex is alone
+ */
+static char *test_board_astar ()
+{
+  board b;
+  board_create (&b);
+
+  FILE *file = tmpfile ();
+  fputs ("Cops: 1\nRobbers: 1\nMax turn: 1\nVertices: 101\n", file);
+  for (size_t i = 0; i < 100; i++)
+    fprintf (file, "%zu.0 %zu\n", i % 10, i / 10);
+  fputs ("50 50\nEdges: 180\n", file);
+  for (size_t i = 0; i < 100; i++)
+    {
+      if (i % 10 < 9)
+        fprintf (file, "%zu %zu\n", i, i + 1);
+      if (i < 90)
+        fprintf (file, "%zu %zu\n", i, i + 10);
+    }
+  rewind (file);
+
+  mu_assert ("Lecture échouée (A*)", board_read_from (&b, file)
+             && board_prepare (&b));
+  mu_assert ("Coordonnées incorrectes", b.x && b.x[37] == 7
+             && b.y[37] == 3 && b.max_edge >= 1 && b.max_edge < 1.001f);
+  for (size_t u = 0; u < b.size; u++)
+    for (size_t v = 0; v < b.size; v++)
+      {
+        size_t next = (size_t) -1, d = board_astar (&b, u, v, &next);
+        mu_assert ("Distance A* incorrecte", d == board_dist (&b, u, v));
+        mu_assert ("Prochain sommet A* incorrect", d == INT_MAX
+                   || (u == v && next == u)
+                   || (board_is_valid_move (&b, u, next)
+                       && board_dist (&b, next, v) == d - 1));
+      }
+
+  board_destroy (&b);
+  fclose (file);
+  return NULL;
+}
+
+/*
+ * All the all-pairs backends must agree, next included, on a graph with
+ * many shortest paths, a duplicate edge, a self-loop and two components
+ */
+static char *test_board_BFS_matches_Floyd_Warshall ()
+{
+  board b;
+  board_create (&b);
+
+  FILE *file = tmpfile ();
+  fputs ("Cops: 1\nRobbers: 1\nMax turn: 1\nVertices: 30\n", file);
+  for (size_t i = 0; i < 30; i++)
+    fputs ("0 0\n", file);
+  fputs ("Edges: 47\n3 3\n0 1\n", file);
+  // Grille 5 x 5 aux arêtes mélangées, puis un cycle de 5 sommets
+  for (size_t k = 0; k < 40; k++)
+    {
+      size_t i = (k * 17) % 40, v = i / 2;
+      size_t u = i % 2 == 0 ? v % 4 + (v / 4) * 5 : v;
+      if (i % 2 == 0)
+        fprintf (file, "%zu %zu\n", u + 1, u);
+      else
+        fprintf (file, "%zu %zu\n", u, u + 5);
+    }
+  for (size_t i = 0; i < 5; i++)
+    fprintf (file, "%zu %zu\n", 25 + i, 25 + (i + 1) % 5);
+  rewind (file);
+
+  mu_assert ("Lecture échouée (BFS)", board_read_from (&b, file));
+  board_Floyd_Warshall (&b);
+  size_t cells = b.size * b.size;
+  size_t *dist = malloc (cells * sizeof (*dist));
+  size_t *next = malloc (cells * sizeof (*next));
+  mu_assert ("Mémoire insuffisante", dist && next && b.dist);
+  for (size_t i = 0; i < cells; i++)
+    {
+      dist[i] = board_dist (&b, i / b.size, i % b.size);
+      next[i] = board_next (&b, i / b.size, i % b.size);
+    }
+  board_BFS_all_pairs (&b);
+  mu_assert ("Tables BFS absentes", b.dist && b.next);
+  for (size_t i = 0; i < cells; i++)
+    mu_assert ("Tables BFS différentes",
+               dist[i] == board_dist (&b, i / b.size, i % b.size)
+               && next[i] == board_next (&b, i / b.size, i % b.size));
+  board_MS_BFS_all_pairs (&b);
+  mu_assert ("Tables MS-BFS absentes", b.dist && b.next);
+  for (size_t i = 0; i < cells; i++)
+    mu_assert ("Tables MS-BFS différentes",
+               dist[i] == board_dist (&b, i / b.size, i % b.size)
+               && next[i] == board_next (&b, i / b.size, i % b.size));
+
+  free (dist);
+  free (next);
+  board_destroy (&b);
+  fclose (file);
+  return NULL;
+}
+
+/*
+ * Tiled Floyd-Warshall on components of several tiles, whose vertices
+ * are spread over the whole board, against breadth-first search and,
+ * with lengths, against Dijkstra's algorithm
+ */
+static char *test_board_Floyd_Warshall_tiled ()
+{
+  board b;
+  board_create (&b);
+
+  // Grille 10 x 15 sur les sommets pairs, cycle de 140 sommets avec des
+  // cordes sur les impairs, une arête et dix sommets isolés
+  size_t n = 302;
+  FILE *file = tmpfile ();
+  fprintf (file, "Cops: 1\nRobbers: 1\nMax turn: 1\nVertices: %zu\n", n);
+  for (size_t i = 0; i < n; i++)
+    fputs ("0 0\n", file);
+  fprintf (file, "Edges: %d\n", 10 * 14 + 9 * 15 + 140 + 10 + 1);
+  for (size_t r = 0; r < 10; r++)
+    for (size_t c = 0; c < 15; c++)
+      {
+        size_t v = r * 15 + c;
+        if (c + 1 < 15)
+          fprintf (file, "%zu %zu\n", 2 * v, 2 * (v + 1));
+        if (r + 1 < 10)
+          fprintf (file, "%zu %zu\n", 2 * v, 2 * (v + 15));
+      }
+  for (size_t i = 0; i < 140; i++)
+    fprintf (file, "%zu %zu\n", 2 * i + 1, 2 * ((i + 1) % 140) + 1);
+  for (size_t i = 0; i < 10; i++)
+    fprintf (file, "%zu %zu\n", 2 * (i * 13) + 1, 2 * ((i * 13 + 50) % 140) + 1);
+  fputs ("300 301\n", file);
+  rewind (file);
+
+  mu_assert ("Lecture échouée (tuiles)", board_read_from (&b, file));
+  fclose (file);
+  mu_assert ("Composantes incorrectes", board_find_components (&b)
+             && b.ncomps == 13);
+  board_Floyd_Warshall (&b);
+  size_t cells = n * n;
+  size_t *dist = malloc (cells * sizeof (*dist));
+  size_t *next = malloc (cells * sizeof (*next));
+  mu_assert ("Mémoire insuffisante", dist && next && b.dist && b.next);
+  for (size_t i = 0; i < cells; i++)
+    {
+      dist[i] = board_dist (&b, i / n, i % n);
+      next[i] = board_next (&b, i / n, i % n);
+    }
+  mu_assert ("Distances Floyd-Warshall incorrectes",
+             dist[0 * n + 2 * 149] == 23 && dist[1 * n + 291] == INT_MAX
+             && dist[292 * n + 292] == 0 && dist[300 * n + 301] == 1);
+  board_BFS_all_pairs (&b);
+  mu_assert ("Tables BFS absentes", b.dist && b.next);
+  for (size_t i = 0; i < cells; i++)
+    mu_assert ("Floyd-Warshall par tuiles différent du BFS",
+               dist[i] == board_dist (&b, i / n, i % n)
+               && next[i] == board_next (&b, i / n, i % n));
+  board_destroy (&b);
+
+  // Même grille et même cycle, de longueurs 0.1 à 0.5
+  board_create (&b);
+  b.weighted = true;
+  file = tmpfile ();
+  fprintf (file, "Cops: 1\nRobbers: 1\nMax turn: 1\nVertices: %zu\n", n);
+  for (size_t i = 0; i < n; i++)
+    fputs ("0 0\n", file);
+  fprintf (file, "Edges: %d\n", 10 * 14 + 9 * 15 + 140 + 10);
+  size_t k = 0;
+  for (size_t r = 0; r < 10; r++)
+    for (size_t c = 0; c < 15; c++)
+      {
+        size_t v = r * 15 + c;
+        if (c + 1 < 15)
+          fprintf (file, "%zu %zu 0.%zu\n", 2 * v, 2 * (v + 1), k++ % 5 + 1);
+        if (r + 1 < 10)
+          fprintf (file, "%zu %zu 0.%zu\n", 2 * v, 2 * (v + 15),
+                   k++ % 5 + 1);
+      }
+  for (size_t i = 0; i < 140; i++)
+    fprintf (file, "%zu %zu 0.%zu\n", 2 * i + 1, 2 * ((i + 1) % 140) + 1,
+             k++ % 5 + 1);
+  for (size_t i = 0; i < 10; i++)
+    fprintf (file, "%zu %zu 0.%zu\n", 2 * (i * 13) + 1,
+             2 * ((i * 13 + 50) % 140) + 1, k++ % 5 + 1);
+  rewind (file);
+
+  mu_assert ("Lecture échouée (tuiles pondérées)",
+             board_read_from (&b, file));
+  fclose (file);
+  mu_assert ("Longueurs absentes (tuiles)", b.weights);
+  board_Floyd_Warshall (&b);
+  unsigned int *row = malloc (n * sizeof (*row));
+  mu_assert ("Tables pondérées absentes", row && b.dist && b.next);
+  for (size_t u = 0; u < n; u++)
+    {
+      mu_assert ("Dijkstra échoué (tuiles)", board_dijkstra (&b, u, row));
+      for (size_t v = 0; v < n; v++)
+        {
+          mu_assert ("Floyd-Warshall pondéré différent de Dijkstra",
+                     row[v] == board_dist (&b, u, v));
+          next[u * n + v] = board_next (&b, u, v);
+        }
+    }
+  board_delta_stepping_all_pairs (&b);
+  for (size_t i = 0; i < cells; i++)
+    mu_assert ("Prochains sommets pondérés différents",
+               next[i] == board_next (&b, i / n, i % n));
+
+  free (row);
+  free (dist);
+  free (next);
+  board_destroy (&b);
+  return NULL;
+}
+
+/*
+ * A chain longer than one batch of simultaneous sources
+ */
+static char *test_board_MS_BFS_chain ()
+{
+  board b;
+  board_create (&b);
+  b.apsp = BOARD_APSP_MSBFS;
+
+  FILE *file = tmpfile ();
+  fputs ("Cops: 1\nRobbers: 1\nMax turn: 1\nVertices: 300\n", file);
+  for (size_t i = 0; i < 300; i++)
+    fputs ("0 0\n", file);
+  fputs ("Edges: 299\n", file);
+  for (size_t i = 0; i < 299; i++)
+    fprintf (file, "%zu %zu\n", i + 1, i);
+  rewind (file);
+
+  mu_assert ("Lecture échouée (MS-BFS)", board_read_from (&b, file));
+  mu_assert ("Préparation MS-BFS échouée", board_prepare (&b));
+  // Diamètre 299 : une case de 8 bits ne suffit plus
+  mu_assert ("Largeur des distances incorrecte", b.dist_width == 2);
+  for (size_t u = 0; u < b.size; u++)
+    for (size_t v = 0; v < b.size; v++)
+      mu_assert ("Chaîne MS-BFS incorrecte",
+                 board_dist (&b, u, v) == (u > v ? u - v : v - u)
+                 && board_next (&b, u, v) == (u < v ? u + 1
+                                              : (u > v ? u - 1 : u)));
+
+  board_destroy (&b);
+  fclose (file);
+  return NULL;
+}
+
+/*
+ * A star whose center has too many neighbors for one-byte slots
+ */
+static char *test_board_next_slots ()
+{
+  board b;
+  board_create (&b);
+
+  FILE *file = tmpfile ();
+  fputs ("Cops: 1\nRobbers: 1\nMax turn: 1\nVertices: 301\n", file);
+  for (size_t i = 0; i < 301; i++)
+    fputs ("0 0\n", file);
+  fputs ("Edges: 301\n1 2\n", file);
+  for (size_t i = 1; i <= 300; i++)
+    fprintf (file, "0 %zu\n", i);
+  rewind (file);
+
+  mu_assert ("Lecture échouée (étoile)", board_read_from (&b, file));
+  mu_assert ("Préparation échouée (étoile)", board_prepare (&b));
+  mu_assert ("Largeur de next incorrecte", b.next_width == 2);
+  mu_assert ("Next de l'étoile incorrect", board_next (&b, 3, 4) == 0
+             && board_next (&b, 0, 300) == 300 && board_next (&b, 1, 2) == 2
+             && board_next (&b, 5, 5) == 5);
+
+
+  board_destroy (&b);
+  fclose (file);
+  return NULL;
+}
+
+/*
+ * Distances read from a cache of two rows must match the tables, next
+ * taking a neighbor one edge closer
+ */
+static char *test_board_row_cache ()
+{
+  board b, full;
+  board_create (&b);
+  board_create (&full);
+
+  FILE *file = tmpfile ();
+  fputs ("Cops: 1\nRobbers: 1\nMax turn: 1\nVertices: 30\n", file);
+  for (size_t i = 0; i < 30; i++)
+    fputs ("0 0\n", file);
+  // Grille 5 x 5, puis un cycle de 5 sommets à part
+  fputs ("Edges: 45\n", file);
+  for (size_t v = 0; v < 25; v++)
+    {
+      if (v % 5 < 4)
+        fprintf (file, "%zu %zu\n", v, v + 1);
+      if (v < 20)
+        fprintf (file, "%zu %zu\n", v, v + 5);
+    }
+  for (size_t i = 0; i < 5; i++)
+    fprintf (file, "%zu %zu\n", 25 + i, 25 + (i + 1) % 5);
+  rewind (file);
+  mu_assert ("Lecture échouée (cache)", board_read_from (&full, file)
+             && board_prepare (&full));
+  rewind (file);
+  b.dist_cache_bytes = 60;
+  mu_assert ("Lecture échouée (cache)", board_read_from (&b, file));
+  mu_assert ("Préparation du cache échouée", board_prepare (&b)
+             && b.row_cache && b.row_cache->rows == 2 && !b.dist);
+
+  unsigned int row[30];
+  for (size_t u = 0; u < b.size; u++)
+    {
+      mu_assert ("Ligne du cache absente", board_dist_row (&b, u, row));
+      for (size_t v = 0; v < b.size; v++)
+        {
+          size_t d = board_dist (&full, u, v), next = board_next (&b, u, v);
+          mu_assert ("Distance du cache incorrecte",
+                     board_dist (&b, u, v) == d && row[v] == d);
+          mu_assert ("Next du cache incorrect", u == v ? next == u
+                     : (d == INT_MAX ? next == INT_MAX
+                        : board_is_valid_move (&b, u, next)
+                        && board_dist (&full, next, v) == d - 1));
+        }
+    }
+  mu_assert ("Statistiques du cache incorrectes", b.row_cache->hits > 0
+             && b.row_cache->misses >= b.size && b.row_cache->used == 2);
+
+  board_destroy (&b);
+  board_destroy (&full);
+  fclose (file);
+  return NULL;
+}
+
+/*
+ * Distances, bounds and next vertices from landmarks against the full
+ * tables, with and without lengths; the single landmark leaves the
+ * cycle without any
+ */
+static char *test_board_landmarks ()
+{
+  for (int weighted = 0; weighted < 2; weighted++)
+    {
+      board b, full;
+      board_create (&b);
+      board_create (&full);
+      b.weighted = full.weighted = weighted;
+
+      FILE *file = tmpfile ();
+      fputs ("Cops: 1\nRobbers: 1\nMax turn: 1\nVertices: 30\n", file);
+      for (size_t i = 0; i < 30; i++)
+        fputs ("0 0\n", file);
+      // Grille 5 x 5 aux longueurs variées, puis un cycle à part
+      fputs ("Edges: 45\n", file);
+      for (size_t v = 0; v < 25; v++)
+        {
+          if (v % 5 < 4)
+            fprintf (file, "%zu %zu %.1f\n", v, v + 1, 0.5 + v % 3 * 0.3);
+          if (v < 20)
+            fprintf (file, "%zu %zu %.1f\n", v, v + 5, 1.4 - v % 4 * 0.3);
+        }
+      for (size_t i = 0; i < 5; i++)
+        fprintf (file, "%zu %zu\n", 25 + i, 25 + (i + 1) % 5);
+      rewind (file);
+      mu_assert ("Lecture échouée (repères)", board_read_from (&full, file)
+                 && board_prepare (&full));
+      rewind (file);
+      b.landmark_count = 1;
+      mu_assert ("Lecture échouée (repères)", board_read_from (&b, file));
+      fclose (file);
+      mu_assert ("Préparation des repères échouée", board_prepare (&b)
+                 && b.landmarks && b.landmarks->count == 1 && !b.dist
+                 && (b.weights != NULL) == weighted);
+
+      unsigned int row[30];
+      for (size_t u = 0; u < b.size; u++)
+        {
+          mu_assert ("Ligne des repères absente", board_dist_row (&b, u, row));
+          for (size_t v = 0; v < b.size; v++)
+            {
+              size_t d = board_dist (&full, u, v), lower, upper;
+              size_t next = board_next (&b, u, v);
+              board_dist_bounds (&b, u, v, &lower, &upper);
+              mu_assert ("Distance des repères incorrecte",
+                         board_dist (&b, u, v) == d && row[v] == d);
+              mu_assert ("Bornes des repères incorrectes",
+                         lower <= d && d <= upper
+                         && (d != INT_MAX || lower == INT_MAX));
+              mu_assert ("Recherche bornée incorrecte",
+                         board_dist_within (&b, u, v, d) == d
+                         && (d == 0 || d == INT_MAX
+                             || board_dist_within (&b, u, v, d - 1)
+                             == INT_MAX));
+              mu_assert ("Next des repères incorrect", u == v ? next == u
+                         : (d == INT_MAX ? next == INT_MAX
+                            : board_is_valid_move (&b, u, next)
+                            && board_dist (&full, next, v)
+                            + board_dist (&full, u, next) == d));
+            }
+        }
+      mu_assert ("Statistiques des repères incorrectes",
+                 b.landmarks->bounded > 0 && b.landmarks->searches > 0);
+
+      board_destroy (&b);
+      board_destroy (&full);
+    }
+  return NULL;
+}
+
+/*
+ * Distances, rows and next vertices of a contraction hierarchy against
+ * the full tables, with and without lengths. The hierarchy file written
+ * by the first board is mapped back by a second one, and rejected once
+ * the lengths change the graph.
+ */
+static char *test_board_hierarchy ()
+{
+  char dir[] = "/tmp/algo_testsXXXXXX";
+  mu_assert ("Répertoire temporaire impossible", mkdtemp (dir));
+  char path[sizeof (dir) + 16];
+  snprintf (path, sizeof (path), "%s/graph.ch", dir);
+  for (int weighted = 0; weighted < 2; weighted++)
+    {
+      board b, again, full;
+      board_create (&b);
+      board_create (&again);
+      board_create (&full);
+      b.weighted = again.weighted = full.weighted = weighted;
+      b.contract = again.contract = true;
+      b.hierarchy_file = again.hierarchy_file = path;
+
+      FILE *file = tmpfile ();
+      fputs ("Cops: 1\nRobbers: 1\nMax turn: 1\nVertices: 30\n", file);
+      for (size_t i = 0; i < 30; i++)
+        fputs ("0 0\n", file);
+      // Même grille que pour les repères, puis le cycle à part
+      fputs ("Edges: 45\n", file);
+      for (size_t v = 0; v < 25; v++)
+        {
+          if (v % 5 < 4)
+            fprintf (file, "%zu %zu %.1f\n", v, v + 1, 0.5 + v % 3 * 0.3);
+          if (v < 20)
+            fprintf (file, "%zu %zu %.1f\n", v, v + 5, 1.4 - v % 4 * 0.3);
+        }
+      for (size_t i = 0; i < 5; i++)
+        fprintf (file, "%zu %zu\n", 25 + i, 25 + (i + 1) % 5);
+      rewind (file);
+      mu_assert ("Lecture échouée (hiérarchie)", board_read_from (&full, file)
+                 && board_prepare (&full));
+      rewind (file);
+      mu_assert ("Lecture échouée (hiérarchie)", board_read_from (&b, file));
+      rewind (file);
+      mu_assert ("Lecture échouée (hiérarchie)",
+                 board_read_from (&again, file));
+      fclose (file);
+      // Le fichier sans longueurs ne vaut plus pour le graphe pondéré
+      mu_assert ("Préparation de la hiérarchie échouée", board_prepare (&b)
+                 && b.hierarchy && !b.hierarchy->map && !b.dist
+                 && (b.weights != NULL) == weighted);
+      mu_assert ("Hiérarchie non relue", board_prepare (&again)
+                 && again.hierarchy->map
+                 && again.hierarchy->shortcuts == b.hierarchy->shortcuts);
+
+      unsigned int row[30];
+      for (size_t u = 0; u < b.size; u++)
+        {
+          mu_assert ("Ligne de la hiérarchie absente",
+                     board_dist_row (&b, u, row));
+          for (size_t v = 0; v < b.size; v++)
+            {
+              size_t d = board_dist (&full, u, v);
+              size_t next = board_next (&b, u, v);
+              mu_assert ("Distance de la hiérarchie incorrecte",
+                         board_dist (&b, u, v) == d && row[v] == d
+                         && board_dist (&again, u, v) == d);
+              mu_assert ("Next de la hiérarchie incorrect", u == v
+                         ? next == u : (d == INT_MAX ? next == INT_MAX
+                                        : board_is_valid_move (&b, u, next)
+                                        && board_dist (&full, next, v)
+                                        + board_dist (&full, u, next) == d));
+            }
+        }
+
+      board_destroy (&b);
+      board_destroy (&again);
+      board_destroy (&full);
+    }
+  unlink (path);
+  rmdir (dir);
+  return NULL;
+}
+
+/*
+ * Distances, rows and next vertices from the block-cut tree against the
+ * full tables, with and without lengths: a cycle, a triangle and a path
+ * hanging from one another, a tree apart and an isolated vertex. A grid
+ * is a single large block and gets the full tables instead.
+ */
+static char *test_board_blocks ()
+{
+  for (int weighted = 0; weighted < 2; weighted++)
+    {
+      board b, full;
+      board_create (&b);
+      board_create (&full);
+      b.weighted = full.weighted = weighted;
+      b.blocks = true;
+
+      FILE *file = tmpfile ();
+      fputs ("Cops: 1\nRobbers: 1\nMax turn: 1\nVertices: 30\n", file);
+      for (size_t i = 0; i < 30; i++)
+        fputs ("0 0\n", file);
+      fputs ("Edges: 29\n0 1 1.5\n1 2 0.5\n2 3 2.5\n3 0 1\n3 4 2\n"
+             "4 5 0.5\n5 3 1\n", file);
+      for (size_t v = 5; v < 14; v++)
+        fprintf (file, "%zu %zu %.1f\n", v, v + 1, 0.5 + v % 3);
+      // Arbre binaire à part, le dernier sommet restant isolé
+      for (size_t v = 16; v < 29; v++)
+        fprintf (file, "%zu %zu %.1f\n", 15 + (v - 16) / 2, v, 1 + v % 2 * 0.5);
+      rewind (file);
+      mu_assert ("Lecture échouée (blocs)", board_read_from (&full, file)
+                 && board_prepare (&full));
+      rewind (file);
+      mu_assert ("Lecture échouée (blocs)", board_read_from (&b, file));
+      fclose (file);
+      mu_assert ("Préparation des blocs échouée", board_prepare (&b)
+                 && b.block_tree && !b.dist
+                 && b.block_tree->nblocks == 24
+                 && b.block_tree->largest == 4 && b.block_tree->trees == 2);
+
+      unsigned int row[30];
+      for (size_t u = 0; u < b.size; u++)
+        {
+          mu_assert ("Ligne des blocs absente", board_dist_row (&b, u, row));
+          for (size_t v = 0; v < b.size; v++)
+            {
+              size_t d = board_dist (&full, u, v);
+              size_t next = board_next (&b, u, v);
+              mu_assert ("Distance des blocs incorrecte",
+                         board_dist (&b, u, v) == d && row[v] == d);
+              mu_assert ("Next des blocs incorrect", u == v ? next == u
+                         : (d == INT_MAX ? next == INT_MAX
+                            : board_is_valid_move (&b, u, next)
+                            && board_dist (&full, next, v)
+                            + board_dist (&full, u, next) == d));
+            }
+        }
+      board_destroy (&b);
+      board_destroy (&full);
+    }
+
+  board grid;
+  board_create (&grid);
+  grid.blocks = true;
+  FILE *file = tmpfile ();
+  fputs ("Cops: 1\nRobbers: 1\nMax turn: 1\nVertices: 9\n", file);
+  for (size_t i = 0; i < 9; i++)
+    fputs ("0 0\n", file);
+  fputs ("Edges: 12\n0 1\n1 2\n3 4\n4 5\n6 7\n7 8\n0 3\n3 6\n1 4\n4 7\n"
+         "2 5\n5 8\n", file);
+  rewind (file);
+  mu_assert ("Lecture échouée (blocs)", board_read_from (&grid, file));
+  fclose (file);
+  mu_assert ("Tables complètes absentes", board_prepare (&grid)
+             && !grid.block_tree && grid.dist && board_dist (&grid, 0, 8) == 4
+             && board_next (&grid, 0, 8) != INT_MAX);
+  board_destroy (&grid);
+  return NULL;
+}
+
+/*
+ * Tables saved in a cache directory by a first board and mapped back by
+ * a second one, which must answer the same
+ */
+static char *test_board_tables_dir ()
+{
+  char dir[] = "/tmp/algo_testsXXXXXX";
+  mu_assert ("Répertoire temporaire impossible", mkdtemp (dir));
+  char data[] = "Cops: 1\nRobbers: 1\nMax turn: 1\nVertices: 6\n"
+    "0 0\n0 0\n0 0\n0 0\n0 0\n0 0\nEdges: 6\n0 1\n1 2\n2 3\n3 0\n"
+    "1 3\n4 5\n";
+  FILE *file = tmpfile ();
+  fputs (data, file);
+
+  board first, second;
+  board_create (&first);
+  board_create (&second);
+  first.dist_cache_dir = second.dist_cache_dir = dir;
+  rewind (file);
+  mu_assert ("Lecture échouée (tables)", board_read_from (&first, file));
+  mu_assert ("Préparation échouée (tables)", board_prepare (&first)
+             && !first.tables_map);
+  rewind (file);
+  mu_assert ("Lecture échouée (tables)", board_read_from (&second, file));
+  mu_assert ("Tables non relues", board_prepare (&second)
+             && second.tables_map && second.next);
+  for (size_t u = 0; u < first.size; u++)
+    for (size_t v = 0; v < first.size; v++)
+      mu_assert ("Tables relues différentes",
+                 board_dist (&first, u, v) == board_dist (&second, u, v)
+                 && board_next (&first, u, v) == board_next (&second, u, v));
+  board_destroy (&first);
+  board_destroy (&second);
+  fclose (file);
+
+  // Un seul fichier, sans fichier temporaire restant
+  DIR *d = opendir (dir);
+  size_t files = 0, tables = 0;
+  for (struct dirent * e; d && (e = readdir (d));)
+    if (e->d_name[0] != '.')
+      {
+        char path[sizeof (dir) + 256];
+        snprintf (path, sizeof (path), "%s/%s", dir, e->d_name);
+        files++;
+        tables += strstr (e->d_name, ".tables") != NULL;
+        unlink (path);
+      }
+  if (d)
+    closedir (d);
+  rmdir (dir);
+  mu_assert ("Fichier de tables absent", files == 1 && tables == 1);
+  return NULL;
+}
+
+static size_t count_segments ()
+{
+  DIR *d = opendir ("/dev/shm");
+  size_t count = 0;
+  for (struct dirent * e; d && (e = readdir (d));)
+    count += strncmp (e->d_name, "crdt-", 5) == 0;
+  if (d)
+    closedir (d);
+  return count;
+}
+
+/*
+ * Two boards of the same graph sharing their tables: the first one
+ * publishes them, the second one attaches, and the segment is gone once
+ * both are destroyed
+ */
+static char *test_board_shared_tables ()
+{
+  char data[] = "Cops: 1\nRobbers: 1\nMax turn: 1\nVertices: 7\n"
+    "0 0\n0 0\n0 0\n0 0\n0 0\n0 0\n0 0\nEdges: 7\n0 1\n1 2\n2 3\n"
+    "3 4\n4 0\n2 5\n5 6\n";
+  FILE *file = tmpfile ();
+  fputs (data, file);
+
+  size_t before = count_segments ();
+  board first, second, alone;
+  board_create (&first);
+  board_create (&second);
+  board_create (&alone);
+  first.share_tables = second.share_tables = true;
+  rewind (file);
+  mu_assert ("Lecture échouée (partage)", board_read_from (&first, file));
+  rewind (file);
+  mu_assert ("Lecture échouée (partage)", board_read_from (&second, file));
+  rewind (file);
+  mu_assert ("Lecture échouée (partage)", board_read_from (&alone, file)
+             && board_prepare (&alone));
+  mu_assert ("Tables non publiées", board_prepare (&first)
+             && first.tables_shared);
+  mu_assert ("Tables non partagées", board_prepare (&second)
+             && second.tables_shared && second.next);
+  for (size_t u = 0; u < alone.size; u++)
+    for (size_t v = 0; v < alone.size; v++)
+      mu_assert ("Tables partagées différentes",
+                 board_dist (&alone, u, v) == board_dist (&second, u, v)
+                 && board_next (&alone, u, v) == board_next (&second, u, v)
+                 && board_next (&alone, u, v) == board_next (&first, u, v));
+
+  // Compte tombé à 0 : le segment est en cours de retrait et un nouveau
+  // venu calcule ses tables sans s'y attacher (refs est le dernier mot
+  // de l'en-tête de 64 octets)
+  uint32_t *refs = (uint32_t *) first.tables_shared + 15;
+  uint32_t attached = *refs;
+  board late;
+  board_create (&late);
+  late.share_tables = true;
+  rewind (file);
+  mu_assert ("Lecture échouée (partage)", board_read_from (&late, file));
+  *refs = 0;
+  bool prepared = board_prepare (&late);
+  *refs = attached;
+  mu_assert ("Segment abandonné rejoint", attached == 2 && prepared
+             && !late.tables_shared && late.dist
+             && board_dist (&late, 0, 6) == 4);
+  board_destroy (&late);
+
+  board_destroy (&first);
+  board_destroy (&second);
+  board_destroy (&alone);
+  fclose (file);
+
+  // Le dernier détaché a retiré le segment (visible sous Linux)
+  mu_assert ("Segment partagé non retiré", count_segments () == before);
+  return NULL;
+}
+
+static char *test_kernel_reduce ()
+{
+  board b;
+  board_create (&b);
+
+  // 0 isolé, 2 et 3 jumeaux, 8 et 9 jumeaux, chaîne 2-1-4-5-6-7-8,
+  // cycle 10-11-12-13-14
+  char data[] = "Cops: 1\nRobbers: 1\nMax turn: 1\nVertices: 15\n"
+    "0 0\n0 0\n0 0\n0 0\n0 0\n0 0\n0 0\n0 0\n0 0\n0 0\n0 0\n0 0\n0 0\n"
+    "0 0\n0 0\nEdges: 15\n1 2\n1 3\n2 3\n1 4\n4 5\n5 6\n6 7\n7 8\n7 9\n"
+    "8 9\n10 11\n11 12\n12 13\n13 14\n14 10\n";
+  FILE *file = tmpfile ();
+  fputs (data, file);
+  rewind (file);
+
+  mu_assert ("Lecture échouée (noyau)", board_read_from (&b, file)
+             && board_prepare (&b));
+  kernel k;
+  mu_assert ("Noyau non construit", kernel_build (&k, &b));
+  mu_assert ("Tailles du noyau incorrectes", k.size == 4 && k.npaths == 3
+             && k.isolated == 1 && k.twins == 2 && k.chained == 8);
+  mu_assert ("Sommet isolé conservé", k.kind[0] == KERNEL_ISOLATED);
+  mu_assert ("Jumeaux non fusionnés", k.kind[3] == KERNEL_TWIN
+             && k.image[3] == 2 && k.kind[9] == KERNEL_TWIN
+             && k.image[9] == 8);
+  for (size_t v = 0; v < b.size; v++)
+    if (k.kind[v] == KERNEL_CHAIN)
+      mu_assert ("Position sur la chaîne incorrecte",
+                 k.members[k.path_start[k.image[v]] + k.position[v] - 1]
+                 == v);
+    else if (k.kind[v] == KERNEL_VERTEX)
+      mu_assert ("Correspondance incorrecte", k.original[k.image[v]] == v);
+  // Les distances entre sommets du noyau sont celles du plateau
+  for (size_t x = 0; x < k.size; x++)
+    for (size_t y = 0; y < k.size; y++)
+      mu_assert ("Distance du noyau incorrecte", kernel_dist (&k, x, y)
+                 == board_dist (&b, k.original[x], k.original[y]));
+  mu_assert ("Cycle mal coupé", k.kind[10] == KERNEL_VERTEX
+             && k.kind[12] == KERNEL_VERTEX
+             && kernel_dist (&k, k.image[10], k.image[12]) == 2);
+
+  kernel_destroy (&k);
+  board_destroy (&b);
+  fclose (file);
+  return NULL;
+}
+
+static char *test_symmetry_cycle ()
+{
+  board b;
+  board_create (&b);
+
+  char data[] = "Cops: 1\nRobbers: 2\nMax turn: 1\n"
+    "Vertices: 6\n0 0\n0 0\n0 0\n0 0\n0 0\n0 0\n"
+    "Edges: 6\n0 1\n1 2\n2 3\n3 4\n4 5\n5 0\n";
+  FILE *file = tmpfile ();
+  fputs (data, file);
+  rewind (file);
+
+  mu_assert ("Lecture échouée (symétries)", board_read_from (&b, file));
+  symmetry g;
+  mu_assert ("Groupe non calculé", symmetry_compute (&g, &b, 100));
+  // Groupe diédral : 6 rotations et 6 réflexions
+  mu_assert ("Ordre du groupe incorrect", g.order == 12 && g.complete);
+  for (size_t k = 0; k < g.ngens; k++)
+    {
+      const uint32_t *perm = g.gens + k * b.size;
+      bool moved = false;
+      for (size_t v = 0; v < b.size; v++)
+        {
+          moved = moved || perm[v] != v;
+          mu_assert ("Générateur incorrect", board_is_valid_move
+                     (&b, perm[v], perm[(v + 1) % b.size]));
+        }
+      mu_assert ("Générateur identité", moved);
+    }
+
+  uint32_t cops[] = { 3 }, robbers[] = { 5, 1 };
+  mu_assert ("Position non canonisée",
+             symmetry_canonicalize (&g, cops, 1, robbers, 2));
+  mu_assert ("Position canonique incorrecte", cops[0] == 0
+             && robbers[0] == 2 && robbers[1] == 4);
+  uint32_t placed[] = { 4 }, waiting[] = { 2, UINT32_MAX };
+  symmetry_canonicalize (&g, placed, 1, waiting, 2);
+  mu_assert ("Jeton non placé modifié", placed[0] == 0 && waiting[0] == 2
+             && waiting[1] == UINT32_MAX);
+  uint32_t lone[] = { 5 };
+  mu_assert ("Gendarme seul non canonisé",
+             symmetry_canonicalize (&g, lone, 1, NULL, 0) && lone[0] == 0);
+
+  // Recherche interrompue : groupe incomplet, pas de forme canonique
+  symmetry g2;
+  mu_assert ("Groupe tronqué non calculé", symmetry_compute (&g2, &b, 2));
+  mu_assert ("Troncature incorrecte", g2.order < 12 && !g2.complete);
+  uint32_t cut[] = { 3 };
+  mu_assert ("Forme canonique d'un groupe incomplet",
+             !symmetry_canonicalize (&g2, cut, 1, NULL, 0) && cut[0] == 3);
+
+  // Sommets isolés : toutes les permutations, trouvées par générateurs
+  board indep;
+  board_create (&indep);
+  char indep_data[] = "Cops: 3\nRobbers: 3\nMax turn: 1\n"
+    "Vertices: 8\n0 0\n0 0\n0 0\n0 0\n0 0\n0 0\n0 0\n0 0\nEdges: 0\n";
+  FILE *indep_file = tmpfile ();
+  fputs (indep_data, indep_file);
+  rewind (indep_file);
+  mu_assert ("Lecture échouée (sommets isolés)",
+             board_read_from (&indep, indep_file));
+  symmetry g3;
+  mu_assert ("Groupe symétrique non calculé",
+             symmetry_compute (&g3, &indep, 1000));
+  mu_assert ("Ordre du groupe symétrique incorrect",
+             g3.order == 40320 && g3.complete && g3.ngens < 40);
+  uint32_t c1[] = { 5 }, r1[] = { 7, 2 }, c2[] = { 6 }, r2[] = { 1, 3 };
+  mu_assert ("Position isolée non canonisée",
+             symmetry_canonicalize (&g3, c1, 1, r1, 2)
+             && symmetry_canonicalize (&g3, c2, 1, r2, 2));
+  mu_assert ("Positions équivalentes distinctes", c1[0] == 0 && c2[0] == 0
+             && r1[0] == 1 && r1[1] == 2 && r2[0] == 1 && r2[1] == 2);
+  symmetry_destroy (&g3);
+  board_destroy (&indep);
+  fclose (indep_file);
+
+  symmetry_destroy (&g);
+  symmetry_destroy (&g2);
+  board_destroy (&b);
+  fclose (file);
+  return NULL;
+}
+
+/*
+ * Weighted edges: lengths read or taken from the coordinates, the
+ * shortest duplicate kept, and every engine giving the same tables
+ */
+static char *test_board_weighted ()
+{
+  board b, copy;
+  board_create (&b);
+  board_create (&copy);
+  b.simplify = true;
+  b.weighted = true;
+  copy.weighted = true;
+
+  FILE *file = tmpfile ();
+  fputs ("Cops: 1\nRobbers: 1\nMax turn: 1\nVertices: 5\n"
+         "0 0\n0.3 0\n0.3 0.4\n1 1\n2 2\nEdges: 7\n0 1\n1 2\n0 2 0.9\n"
+         "2 3 0.1\n3 0 2\n3 0 5e-1\n4 4\n", file);
+  rewind (file);
+  mu_assert ("Lecture échouée (pondéré)", board_read_from (&b, file)
+             && board_prepare (&b));
+  fclose (file);
+  mu_assert ("Longueurs absentes", b.weights && b.removed_edges == 2);
+  mu_assert ("Distances pondérées incorrectes",
+             board_dist (&b, 0, 1) == 3000 && board_dist (&b, 0, 2) == 6000
+             && board_dist (&b, 0, 3) == 5000
+             && board_dist (&b, 1, 3) == 5000
+             && board_dist (&b, 0, 4) == INT_MAX);
+  mu_assert ("Prochains sommets pondérés incorrects",
+             board_next (&b, 0, 2) == 3 && board_next (&b, 1, 3) == 2
+             && board_next (&b, 2, 0) == 3);
+
+  size_t dist[25], next[25];
+  unsigned int row[5], full[5];
+  for (size_t i = 0; i < 25; i++)
+    {
+      dist[i] = board_dist (&b, i / 5, i % 5);
+      next[i] = board_next (&b, i / 5, i % 5);
+    }
+  board_Floyd_Warshall (&b);
+  mu_assert ("Tables Floyd-Warshall absentes", b.dist && b.next);
+  for (size_t i = 0; i < 25; i++)
+    mu_assert ("Tables Floyd-Warshall différentes",
+               dist[i] == board_dist (&b, i / 5, i % 5)
+               && next[i] == board_next (&b, i / 5, i % 5));
+  for (size_t u = 0; u < b.size; u++)
+    {
+      mu_assert ("Dijkstra échoué", board_dijkstra (&b, u, row)
+                 && board_dist_row (&b, u, full));
+      for (size_t v = 0; v < b.size; v++)
+        mu_assert ("Dijkstra, ligne ou A* incorrect",
+                   row[v] == board_dist (&b, u, v) && full[v] == row[v]
+                   && board_astar (&b, u, v, NULL) == board_dist (&b, u, v));
+    }
+
+  char name[] = "/tmp/algo_testsXXXXXX";
+  int fd = mkstemp (name);
+  file = fd >= 0 ? fdopen (fd, "wb") : NULL;
+  mu_assert ("Écriture binaire échouée", file
+             && board_write_binary (&b, file));
+  fclose (file);
+  bool read = board_read_binary (&copy, name);
+  remove (name);
+  mu_assert ("Relecture pondérée échouée", read && copy.weights
+             && board_prepare (&copy) && board_dist (&copy, 1, 3) == 5000);
+  mu_assert ("Reordonnancement échoué", board_reorder (&copy)
+             && board_prepare (&copy));
+  for (size_t u = 0; u < b.size; u++)
+    for (size_t v = 0; v < b.size; v++)
+      mu_assert ("Distance après renumérotation incorrecte",
+                 board_dist (&copy, board_internal_index (&copy, u),
+                             board_internal_index (&copy, v))
+                 == board_dist (&b, u, v));
+
+  board_destroy (&b);
+  board_destroy (&copy);
+  return NULL;
+}
+
+/*
+ * Lengths too long to be stored, or adding up to INT_MAX, make a map
+ * invalid; just below, every backend gives the same distances
+ */
+static char *test_board_long_lengths ()
+{
+  board b;
+  board_create (&b);
+  b.weighted = true;
+  FILE *file = tmpfile ();
+  fputs ("Cops: 1\nRobbers: 1\nMax turn: 1\nVertices: 2\n0 0\n0 0\n"
+         "Edges: 1\n0 1 2000\n", file);
+  rewind (file);
+  mu_assert ("Arête trop longue acceptée", !board_read_from (&b, file));
+  fclose (file);
+  board_destroy (&b);
+
+  // Chaîne de 299 arêtes et un sommet isolé : 299 000 de long ne tient
+  // pas sous INT_MAX unités, 299 * 700 si
+  for (size_t length = 1000; length >= 700; length -= 300)
+    for (size_t mode = 0; mode < 5; mode++)
+      {
+        board_create (&b);
+        b.weighted = true;
+        b.dist_cache_bytes = mode == 1 ? 1 << 16 : 0;
+        b.landmark_count = mode == 2 ? 4 : 0;
+        b.contract = mode == 3;
+        b.blocks = mode == 4;
+        file = tmpfile ();
+        fputs ("Cops: 1\nRobbers: 1\nMax turn: 1\nVertices: 301\n", file);
+        for (size_t i = 0; i < 301; i++)
+          fputs ("0 0\n", file);
+        fputs ("Edges: 299\n", file);
+        for (size_t i = 0; i < 299; i++)
+          fprintf (file, "%zu %zu %zu\n", i, i + 1, length);
+        rewind (file);
+        bool read = board_read_from (&b, file);
+        fclose (file);
+        if (length == 1000)
+          mu_assert ("Chemins trop longs acceptés", !read);
+        else
+          {
+            mu_assert ("Lecture échouée (longueurs)", read
+                       && board_prepare (&b));
+            mu_assert ("Distances des modes différentes",
+                       board_dist (&b, 0, 299) == 299 * 7000000u
+                       && board_dist (&b, 299, 0) == 299 * 7000000u
+                       && board_dist (&b, 10, 20) == 10 * 7000000u
+                       && board_dist (&b, 0, 300) == INT_MAX
+                       && board_next (&b, 0, 299) == 1);
+          }
+        board_destroy (&b);
+      }
+
+  // Poids hors bornes dans une carte binaire
+  board_create (&b);
+  b.weighted = true;
+  file = tmpfile ();
+  fputs ("Cops: 1\nRobbers: 1\nMax turn: 1\nVertices: 2\n0 0\n0 0\n"
+         "Edges: 1\n0 1 3\n", file);
+  rewind (file);
+  mu_assert ("Lecture échouée (binaire pondéré)", board_read_from (&b, file));
+  fclose (file);
+  char name[] = "/tmp/algo_testsXXXXXX";
+  int fd = mkstemp (name);
+  file = fd >= 0 ? fdopen (fd, "w+b") : NULL;
+  mu_assert ("Écriture binaire échouée (longueurs)", file
+             && board_write_binary (&b, file));
+  uint32_t weight = BOARD_WEIGHT_MAX + 1;
+  fseek (file, -(long) sizeof (weight), SEEK_END);
+  fwrite (&weight, sizeof (weight), 1, file);
+  fclose (file);
+  board copy;
+  board_create (&copy);
+  copy.weighted = true;
+  bool read = board_read_binary (&copy, name);
+  remove (name);
+  mu_assert ("Poids binaire trop long accepté", !read && !copy.offsets);
+  board_destroy (&copy);
+  board_destroy (&b);
+  return NULL;
+}
+
 char *(*tests_functions[]) () = { test_board_Floyd_Warshall_chain,
   test_board_single_node,
   test_board_two_nodes_disconnected,
@@ -304,7 +1560,28 @@ char *(*tests_functions[]) () = { test_board_Floyd_Warshall_chain,
   test_board_read_from_more_edges_than_declared,
   test_board_read_from_edge_with_invalid_vertex,
   test_board_read_from_invalid_robbers,
-  test_board_read_from_valid_autoedge
+  test_board_read_from_valid_autoedge,
+  test_board_valid_move_large,
+  test_board_read_from_simplify,
+  test_board_read_from_long_lines,
+  test_board_binary_round_trip,
+  test_board_reorder,
+  test_board_prepare_shared,
+  test_board_astar,
+  test_board_BFS_matches_Floyd_Warshall,
+  test_board_Floyd_Warshall_tiled,
+  test_board_MS_BFS_chain,
+  test_board_next_slots,
+  test_board_row_cache,
+  test_board_landmarks,
+  test_board_hierarchy,
+  test_board_blocks,
+  test_board_tables_dir,
+  test_board_shared_tables,
+  test_kernel_reduce,
+  test_symmetry_cycle,
+  test_board_weighted,
+  test_board_long_lengths
 };
 
 int main (int argc, const char *argv[])
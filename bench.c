@@ -0,0 +1,207 @@
+#define _DEFAULT_SOURCE
+#include "algo.h"
+#include "blocks.h"
+#include "hierarchy.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+/*
+ * Time the loading of a map, the all-pairs shortest paths, a workload
+ * shaped like the per-turn move computation of game.c and single-pair
+ * A* queries: ./bench map [--reorder] [--weighted]
+ * [--msbfs | --floyd-warshall | --delta-stepping] [--dist-cache-mb N]
+ * [--landmarks K] [--dist-cache-dir DIR] [--shared-tables]
+ * [--hierarchy [--hierarchy-file F]] [--blocks]
+ */
+
+#define BENCH_TURNS 20
+#define BENCH_QUERIES 1000
+
+static double now (void)
+{
+  struct timeval t;
+  gettimeofday (&t, NULL);
+  return t.tv_sec + t.tv_usec / 1e6;
+}
+
+/*
+ * For every vertex taken as a robber, score it and its neighbors
+ * against a few cops like move_robbers does, step each cop towards it
+ * like move_cops and sum the distances from the robber to every vertex
+ * like the dist_moy scores
+ */
+static unsigned long turn_workload (board *b, const size_t *cops,
+                                    size_t ncops, unsigned int *row)
+{
+  unsigned long acc = 0;
+  for (size_t v = 0; v < b->size; v++)
+    {
+      const uint32_t *neighbors = board_neighbors (b, v);
+      for (size_t j = 0; j <= board_degree (b, v); j++)
+        {
+          size_t candidate = j == board_degree (b, v) ? v : neighbors[j];
+          size_t best = (size_t) -1;
+          for (size_t c = 0; c < ncops; c++)
+            {
+              size_t d = board_dist (b, candidate, cops[c]);
+              best = d < best ? d : best;
+            }
+          acc += best;
+        }
+      for (size_t c = 0; c < ncops; c++)
+        acc += board_next (b, cops[c], v);
+      board_dist_row (b, v, row);
+      for (size_t u = 0; u < b->size; u++)
+        acc += row[u];
+    }
+  return acc;
+}
+
+int main (int argc, const char *argv[])
+{
+  if (argc < 2)
+    {
+      fprintf (stderr, "Usage: ./bench map [--reorder] [--weighted] "
+               "[--msbfs | --floyd-warshall | --delta-stepping] "
+               "[--dist-cache-mb N] [--landmarks K] [--dist-cache-dir DIR] "
+               "[--shared-tables] [--hierarchy [--hierarchy-file F]] "
+               "[--blocks]\n");
+      exit (-1);
+    }
+  bool reorder = false, weighted = false;
+  bool share = false, contract = false, blocks = false;
+  size_t cache_mb = 0, landmarks = 0;
+  const char *cache_dir = NULL, *hierarchy_file = NULL;
+  enum board_apsp apsp = BOARD_APSP_BFS;
+  const char *names[] =
+    { "bfs", "msbfs", "floyd-warshall", "delta-stepping" };
+  for (int i = 2; i < argc; i++)
+    {
+      if (strcmp (argv[i], "--reorder") == 0)
+        reorder = true;
+      else if (strcmp (argv[i], "--weighted") == 0)
+        weighted = true;
+      else if (strcmp (argv[i], "--msbfs") == 0)
+        apsp = BOARD_APSP_MSBFS;
+      else if (strcmp (argv[i], "--floyd-warshall") == 0)
+        apsp = BOARD_APSP_FLOYD_WARSHALL;
+      else if (strcmp (argv[i], "--delta-stepping") == 0)
+        apsp = BOARD_APSP_DELTA_STEPPING;
+      else if (strcmp (argv[i], "--dist-cache-mb") == 0 && i + 1 < argc
+               && atoi (argv[i + 1]) > 0)
+        cache_mb = atoi (argv[++i]);
+      else if (strcmp (argv[i], "--landmarks") == 0 && i + 1 < argc
+               && atoi (argv[i + 1]) > 0)
+        landmarks = atoi (argv[++i]);
+      else if (strcmp (argv[i], "--dist-cache-dir") == 0 && i + 1 < argc)
+        cache_dir = argv[++i];
+      else if (strcmp (argv[i], "--shared-tables") == 0)
+        share = true;
+      else if (strcmp (argv[i], "--hierarchy") == 0)
+        contract = true;
+      else if (strcmp (argv[i], "--hierarchy-file") == 0 && i + 1 < argc)
+        hierarchy_file = argv[++i];
+      else if (strcmp (argv[i], "--blocks") == 0)
+        blocks = true;
+      else
+        {
+          fprintf (stderr, "Unknown option %s\n", argv[i]);
+          exit (-1);
+        }
+    }
+
+  board b;
+  board_create (&b);
+  b.simplify = true;
+  b.weighted = weighted;
+  b.dist_cache_bytes = cache_mb << 20;
+  b.landmark_count = landmarks;
+  b.dist_cache_dir = cache_dir;
+  b.share_tables = share;
+  b.contract = contract;
+  b.hierarchy_file = hierarchy_file;
+  b.blocks = blocks;
+  b.apsp = apsp;
+  double start = now ();
+  if (!board_read_binary (&b, argv[1]) && !board_load (&b, argv[1]))
+    {
+      fprintf (stderr, "Error parsing input file %s\n", argv[1]);
+      exit (-1);
+    }
+  double loaded = now ();
+  if (reorder && !board_reorder (&b))
+    {
+      fprintf (stderr, "Error reordering vertices\n");
+      exit (-1);
+    }
+  double reordered = now ();
+  // Avec le cache, seules ses lignes vides sont allouées, avec les
+  // repères seules leurs distances ; avec le répertoire ou le partage,
+  // les tables sont relues si elles existent, comme la hiérarchie ;
+  // avec les blocs, les tables complètes ne servent que s'ils sont gros
+  if (b.dist_cache_bytes || b.landmark_count || b.dist_cache_dir
+      || b.share_tables || b.contract || b.blocks)
+    board_prepare (&b);
+  else
+    board_all_pairs (&b);
+  double tables = now ();
+
+  // Gendarmes aux mêmes sommets du fichier quel que soit l'ordre interne
+  size_t cops[3];
+  for (size_t c = 0; c < 3; c++)
+    cops[c] = board_internal_index (&b, (c * b.size) / 3);
+  unsigned long acc = 0;
+  unsigned int *row = malloc (b.size * sizeof (*row));
+  if (!row)
+    {
+      fprintf (stderr, "Out of memory\n");
+      exit (-1);
+    }
+  for (size_t t = 0; t < BENCH_TURNS; t++)
+    acc += turn_workload (&b, cops, 3, row);
+  free (row);
+  double turn = now ();
+
+  // Paires pseudo-aléatoires, vérifiées contre la table des distances
+  size_t wrong = 0;
+  srand (1);
+  for (size_t q = 0; q < BENCH_QUERIES; q++)
+    {
+      size_t u = rand () % b.size, v = rand () % b.size;
+      wrong += board_astar (&b, u, v, NULL) != board_dist (&b, u, v);
+    }
+  double astar = now ();
+
+  printf ("%s%s%s: %zu vertices, load %.3f s, reorder %.3f s, "
+          "%s %.3f s, %d turns %.3f s (%lu), %d A* queries %.3f s "
+          "(%zu wrong)\n", argv[1], reorder ? " --reorder" : "",
+          weighted ? " --weighted" : "", b.size,
+          loaded - start, reordered - loaded,
+          b.row_cache ? "row cache" : b.landmarks ? "landmarks"
+          : b.hierarchy ? "hierarchy" : b.block_tree ? "block tree"
+          : b.tables_shared ? "shared tables"
+          : b.tables_map ? "mapped tables"
+          : b.weights && apsp < BOARD_APSP_FLOYD_WARSHALL ? names[3]
+          : names[apsp],
+          tables - reordered, BENCH_TURNS, turn - tables, acc,
+          BENCH_QUERIES, astar - turn, wrong);
+  if (b.row_cache)
+    printf ("%zu cached rows, %zu hits, %zu misses\n", b.row_cache->rows,
+            b.row_cache->hits, b.row_cache->misses);
+  if (b.landmarks)
+    printf ("%zu landmarks, %zu queries bounded, %zu searched\n",
+            b.landmarks->count, b.landmarks->bounded, b.landmarks->searches);
+  if (b.hierarchy)
+    printf ("%zu shortcuts, %zu queries, %.1f settled per query\n",
+            b.hierarchy->shortcuts, b.hierarchy->queries,
+            (double) b.hierarchy->settled
+            / (b.hierarchy->queries ? b.hierarchy->queries : 1));
+  if (b.block_tree)
+    printf ("%zu blocks, largest %zu vertices, %zu tree components\n",
+            b.block_tree->nblocks, b.block_tree->largest,
+            b.block_tree->trees);
+  board_destroy (&b);
+  return 0;
+}
@@ -0,0 +1,592 @@
+#include "blocks.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Positions of the walk that a query scans one by one at each end of
+ * its range, the runs of whole spans in between being read in sparse
+ */
+#define BLOCK_TREE_SPAN 32
+
+/*
+ * The blocks are kept only if their tables hold at most one pair in
+ * BLOCK_TREE_SHARE of the pairs of the full tables
+ */
+#define BLOCK_TREE_SHARE 4
+
+#define NONE UINT32_MAX
+
+static void heap_push (uint64_t *heap, size_t *len, uint64_t key)
+{
+  size_t i = (*len)++;
+  for (; i > 0 && heap[(i - 1) / 2] > key; i = (i - 1) / 2)
+    heap[i] = heap[(i - 1) / 2];
+  heap[i] = key;
+}
+
+static uint64_t heap_pop (uint64_t *heap, size_t *len)
+{
+  uint64_t top = heap[0], last = heap[--(*len)];
+  size_t i = 0;
+  for (size_t c; (c = 2 * i + 1) < *len; i = c)
+    {
+      if (c + 1 < *len && heap[c + 1] < heap[c])
+        c++;
+      if (last <= heap[c])
+        break;
+      heap[i] = heap[c];
+    }
+  heap[i] = last;
+  return top;
+}
+
+static inline size_t block_size (const block_tree *self, size_t b)
+{
+  return self->start[b + 1] - self->start[b];
+}
+
+/*
+ * Distance between the vertices i and j of block b
+ */
+static inline size_t block_pair_dist (const block_tree *self, size_t b,
+                                      size_t i, size_t j)
+{
+  if (i == j)
+    return 0;
+  if (i > j)
+    {
+      size_t t = i;
+      i = j;
+      j = t;
+    }
+  size_t k = block_size (self, b);
+  return self->dist[self->table_start[b] + i * (2 * k - i - 1) / 2
+                    + j - i - 1];
+}
+
+/*
+ * Biconnected components by an iterative depth-first search: a block
+ * is complete when the search leaves a vertex whose subtree cannot
+ * reach above its parent, the head of the block. full receives the
+ * number of pairs of the full tables. Return false if memory is
+ * missing.
+ */
+static bool find_blocks (block_tree *self, const board *b, size_t *full)
+{
+  size_t n = b->size;
+  uint32_t *disc = malloc (5 * n * sizeof (*disc));
+  self->home = malloc (n * sizeof (*self->home));
+  self->local = malloc (n * sizeof (*self->local));
+  self->members = malloc (2 * n * sizeof (*self->members));
+  self->start = malloc ((n + 1) * sizeof (*self->start));
+  if (!disc || !self->home || !self->local || !self->members
+      || !self->start)
+    {
+      free (disc);
+      return false;
+    }
+  uint32_t *low = disc + n, *parent = low + n, *iter = parent + n;
+  uint32_t *stack = iter + n;
+  for (size_t v = 0; v < n; v++)
+    disc[v] = NONE;
+  uint32_t time = 0, top = 0, len = 0;
+  self->start[0] = 0;
+  *full = 0;
+  for (size_t s = 0; s < n; s++)
+    {
+      if (disc[s] != NONE)
+        continue;
+      size_t before = time, blocks = self->nblocks;
+      disc[s] = low[s] = time++;
+      parent[s] = NONE;
+      iter[s] = 0;
+      self->home[s] = NONE;
+      self->local[s] = 0;
+      uint32_t v = s;
+      while (v != NONE)
+        {
+          const uint32_t *neighbors = board_neighbors (b, v);
+          if (iter[v] < board_degree (b, v))
+            {
+              uint32_t w = neighbors[iter[v]++];
+              if (disc[w] == NONE)
+                {
+                  disc[w] = low[w] = time++;
+                  parent[w] = v;
+                  iter[w] = 0;
+                  stack[top++] = w;
+                  v = w;
+                }
+              else if (w != parent[v] && disc[w] < low[v])
+                low[v] = disc[w];
+              continue;
+            }
+          uint32_t p = parent[v];
+          if (p != NONE && low[v] < low[p])
+            low[p] = low[v];
+          // Le sous-arbre de v ne remonte pas au-dessus de p : un bloc
+          if (p != NONE && low[v] >= disc[p])
+            {
+              size_t block = self->nblocks++;
+              self->members[len++] = p;
+              uint32_t x;
+              do
+                {
+                  x = stack[--top];
+                  self->home[x] = block;
+                  self->local[x] = len - self->start[block];
+                  self->members[len++] = x;
+                }
+              while (x != v);
+              self->start[block + 1] = len;
+            }
+          v = p;
+        }
+      // Un arbre n'a que des ponts, un bloc par arête
+      size_t size = time - before;
+      *full += size * (size - 1) / 2;
+      self->trees += self->nblocks - blocks == size - 1;
+    }
+  free (disc);
+  return true;
+}
+
+/*
+ * Block of the edge between v and w, and index of v in that block
+ */
+static uint32_t edge_block (const block_tree *self, uint32_t v, uint32_t w,
+                            uint32_t *index)
+{
+  uint32_t hv = self->home[v], hw = self->home[w];
+  if (hv != NONE && hv == hw)
+    {
+      *index = self->local[v];
+      return hv;
+    }
+  if (hw != NONE && self->members[self->start[hw]] == v)
+    {
+      *index = 0;
+      return hw;
+    }
+  *index = self->local[v];
+  return hv;
+}
+
+/*
+ * Spread the edges of the board over the blocks, each vertex of a
+ * block keeping its edges inside it in the order of its neighbors
+ */
+static bool block_edges (block_tree *self, const board *b)
+{
+  size_t slots = self->start[self->nblocks];
+  self->adj_start = calloc (slots + 1, sizeof (*self->adj_start));
+  uint32_t *fill = malloc ((slots + 1) * sizeof (*fill));
+  if (!self->adj_start || !fill)
+    {
+      free (fill);
+      return false;
+    }
+  for (size_t v = 0; v < b->size; v++)
+    {
+      const uint32_t *neighbors = board_neighbors (b, v);
+      for (size_t i = 0; i < board_degree (b, v); i++)
+        if (neighbors[i] != v)
+          {
+            uint32_t index, block = edge_block (self, v, neighbors[i],
+                                                &index);
+            self->adj_start[self->start[block] + index + 1]++;
+          }
+    }
+  for (size_t s = 0; s < slots; s++)
+    self->adj_start[s + 1] += self->adj_start[s];
+  memcpy (fill, self->adj_start, (slots + 1) * sizeof (*fill));
+  size_t edges = self->adj_start[slots];
+  self->adj = malloc ((edges ? edges : 1) * sizeof (*self->adj));
+  if (b->weights)
+    self->lengths = malloc ((edges ? edges : 1) * sizeof (*self->lengths));
+  if (!self->adj || (b->weights && !self->lengths))
+    {
+      free (fill);
+      return false;
+    }
+  for (size_t v = 0; v < b->size; v++)
+    {
+      const uint32_t *neighbors = board_neighbors (b, v);
+      for (size_t i = 0; i < board_degree (b, v); i++)
+        if (neighbors[i] != v)
+          {
+            uint32_t index, other;
+            uint32_t block = edge_block (self, v, neighbors[i], &index);
+            edge_block (self, neighbors[i], v, &other);
+            uint32_t e = fill[self->start[block] + index]++;
+            self->adj[e] = other;
+            if (self->lengths)
+              self->lengths[e] = b->weights[b->offsets[v] + i];
+          }
+    }
+  free (fill);
+  return true;
+}
+
+/*
+ * Distances inside block b from its vertex i to the vertices after it,
+ * by a breadth-first search, or Dijkstra's algorithm with lengths
+ */
+static void block_search (block_tree *self, size_t b, size_t i,
+                          unsigned int *dist, uint32_t *queue,
+                          uint64_t *heap)
+{
+  size_t k = block_size (self, b), base = self->start[b];
+  for (size_t j = 0; j < k; j++)
+    dist[j] = INT_MAX;
+  dist[i] = 0;
+  if (!self->lengths)
+    {
+      size_t head = 0, tail = 0;
+      queue[tail++] = i;
+      while (head < tail)
+        {
+          uint32_t x = queue[head++];
+          for (size_t e = self->adj_start[base + x];
+               e < self->adj_start[base + x + 1]; e++)
+            if (dist[self->adj[e]] == INT_MAX)
+              {
+                dist[self->adj[e]] = dist[x] + 1;
+                queue[tail++] = self->adj[e];
+              }
+        }
+    }
+  else
+    {
+      size_t len = 0;
+      heap_push (heap, &len, i);
+      while (len > 0)
+        {
+          uint64_t top = heap_pop (heap, &len);
+          uint32_t x = (uint32_t) top, d = top >> 32;
+          if (d > dist[x])
+            continue;
+          for (size_t e = self->adj_start[base + x];
+               e < self->adj_start[base + x + 1]; e++)
+            {
+              unsigned int through = d + self->lengths[e];
+              if (through < dist[self->adj[e]])
+                {
+                  dist[self->adj[e]] = through;
+                  heap_push (heap, &len,
+                             (uint64_t) through << 32 | self->adj[e]);
+                }
+            }
+        }
+    }
+  unsigned int *row = self->dist + self->table_start[b]
+    + i * (2 * k - i - 1) / 2;
+  for (size_t j = i + 1; j < k; j++)
+    row[j - i - 1] = dist[j];
+}
+
+/*
+ * Tables of all the blocks, from the search of each of their vertices
+ */
+static bool block_tables (block_tree *self)
+{
+  size_t edges = 0, total = self->table_start[self->nblocks];
+  for (size_t b = 0; b < self->nblocks; b++)
+    {
+      size_t e = self->adj_start[self->start[b + 1]]
+        - self->adj_start[self->start[b]];
+      edges = e > edges ? e : edges;
+    }
+  self->dist = malloc ((total ? total : 1) * sizeof (*self->dist));
+  unsigned int *dist = malloc ((self->largest + 1) * sizeof (*dist));
+  uint32_t *queue = malloc ((self->largest + 1) * sizeof (*queue));
+  uint64_t *heap = malloc ((edges + 1) * sizeof (*heap));
+  bool ok = self->dist && dist && queue && heap;
+  for (size_t b = 0; ok && b < self->nblocks; b++)
+    for (size_t i = 0; i + 1 < block_size (self, b); i++)
+      block_search (self, b, i, dist, queue, heap);
+  free (dist);
+  free (queue);
+  free (heap);
+  return ok;
+}
+
+/*
+ * Walk the block-cut tree depth first from the node above the
+ * components, storing each node every time it is reached and the
+ * distance of each vertex from the first vertex of its component
+ */
+static bool block_walk (block_tree *self)
+{
+  size_t n = self->size, nodes = n + self->nblocks + 1;
+  uint32_t root = nodes - 1;
+  self->tour_len = 2 * nodes - 1;
+  self->euler = malloc (self->tour_len * sizeof (*self->euler));
+  self->level = malloc (self->tour_len * sizeof (*self->level));
+  self->first = malloc (nodes * sizeof (*self->first));
+  self->last = malloc (nodes * sizeof (*self->last));
+  self->down = malloc (n * sizeof (*self->down));
+  // Blocs sous chaque sommet, premiers sommets des composantes, pile
+  uint32_t *below_start = calloc (n + 2, sizeof (*below_start));
+  uint32_t *below = malloc ((self->nblocks + 1) * sizeof (*below));
+  uint32_t *firsts = malloc (n * sizeof (*firsts));
+  uint32_t *node = malloc (nodes * sizeof (*node));
+  uint32_t *child = malloc (nodes * sizeof (*child));
+  bool ok = self->euler && self->level && self->first && self->last
+    && self->down && below_start && below && firsts && node && child;
+  if (ok)
+    {
+      size_t nfirsts = 0;
+      // Comptés un cran plus loin, les débuts avancent jusqu'aux fins
+      for (size_t b = 0; b < self->nblocks; b++)
+        below_start[self->members[self->start[b]] + 2]++;
+      for (size_t v = 0; v < n; v++)
+        below_start[v + 2] += below_start[v + 1];
+      for (size_t b = 0; b < self->nblocks; b++)
+        below[below_start[self->members[self->start[b]] + 1]++] = b;
+      for (size_t v = 0; v < n; v++)
+        if (self->home[v] == NONE)
+          firsts[nfirsts++] = v;
+
+      size_t len = 0, depth = 1;
+      node[0] = root;
+      child[0] = 0;
+      self->first[root] = 0;
+      self->euler[len] = root;
+      self->level[len++] = 0;
+      while (depth > 0)
+        {
+          uint32_t x = node[depth - 1], c = child[depth - 1]++;
+          uint32_t y = NONE;
+          if (x == root)
+            y = c < nfirsts ? firsts[c] : NONE;
+          else if (x < n)
+            y = c < below_start[x + 1] - below_start[x]
+              ? n + below[below_start[x] + c] : NONE;
+          else if (c + 1 < block_size (self, x - n))
+            y = self->members[self->start[x - n] + 1 + c];
+          if (y == NONE)
+            {
+              // Retour au parent, repris dans le parcours
+              self->last[x] = len - 1;
+              if (--depth > 0)
+                {
+                  self->euler[len] = node[depth - 1];
+                  self->level[len++] = depth - 1;
+                }
+              continue;
+            }
+          if (y < n)
+            self->down[y] = self->home[y] == NONE ? 0
+              : self->down[self->members[self->start[self->home[y]]]]
+              + block_pair_dist (self, self->home[y], 0, self->local[y]);
+          node[depth] = y;
+          child[depth] = 0;
+          self->first[y] = len;
+          self->euler[len] = y;
+          self->level[len++] = depth++;
+        }
+    }
+  free (below_start);
+  free (below);
+  free (firsts);
+  free (node);
+  free (child);
+  return ok;
+}
+
+/*
+ * Of the positions a and b > a of the walk, the shallower one, b when
+ * they tie
+ */
+static inline size_t shallower (const block_tree *self, size_t a, size_t b)
+{
+  return self->level[b] <= self->level[a] ? b : a;
+}
+
+/*
+ * Sparse table over the spans of the walk: row k holds for every span
+ * the rightmost shallowest position of the 2^k spans starting there
+ */
+static bool block_sparse (block_tree *self)
+{
+  size_t spans = (self->tour_len + BLOCK_TREE_SPAN - 1) / BLOCK_TREE_SPAN;
+  size_t rows = 64 - __builtin_clzll (spans);
+  self->spans = spans;
+  self->sparse = malloc (rows * spans * sizeof (*self->sparse));
+  if (!self->sparse)
+    return false;
+  for (size_t s = 0; s < spans; s++)
+    {
+      size_t best = s * BLOCK_TREE_SPAN;
+      for (size_t i = best + 1;
+           i < (s + 1) * BLOCK_TREE_SPAN && i < self->tour_len; i++)
+        best = shallower (self, best, i);
+      self->sparse[s] = best;
+    }
+  for (size_t k = 1; k < rows; k++)
+    for (size_t s = 0; s + ((size_t) 1 << k) <= spans; s++)
+      self->sparse[k * spans + s] =
+        shallower (self, self->sparse[(k - 1) * spans + s],
+                   self->sparse[(k - 1) * spans + s + (1 << (k - 1))]);
+  return true;
+}
+
+/*
+ * Rightmost shallowest position between positions l and r included
+ */
+static size_t lowest (const block_tree *self, size_t l, size_t r)
+{
+  size_t sl = l / BLOCK_TREE_SPAN, sr = r / BLOCK_TREE_SPAN;
+  size_t end = sl == sr ? r : (sl + 1) * BLOCK_TREE_SPAN - 1, best = l;
+  for (size_t i = l + 1; i <= end; i++)
+    best = shallower (self, best, i);
+  if (sl == sr)
+    return best;
+  if (sr > sl + 1)
+    {
+      size_t count = sr - sl - 1, k = 63 - __builtin_clzll (count);
+      const uint32_t *row = self->sparse + k * self->spans;
+      best = shallower (self, best, row[sl + 1]);
+      best = shallower (self, best, row[sr - ((size_t) 1 << k)]);
+    }
+  for (size_t i = sr * BLOCK_TREE_SPAN; i <= r; i++)
+    best = shallower (self, best, i);
+  return best;
+}
+
+bool block_tree_build (block_tree *self, const board *b)
+{
+  memset (self, 0, sizeof (*self));
+  self->size = b->size;
+  size_t full;
+  if (!find_blocks (self, b, &full))
+    {
+      block_tree_destroy (self);
+      return false;
+    }
+  self->table_start = malloc ((self->nblocks + 1)
+                              * sizeof (*self->table_start));
+  if (!self->table_start)
+    {
+      block_tree_destroy (self);
+      return false;
+    }
+  self->table_start[0] = 0;
+  for (size_t i = 0; i < self->nblocks; i++)
+    {
+      size_t k = block_size (self, i);
+      self->largest = k > self->largest ? k : self->largest;
+      self->table_start[i + 1] = self->table_start[i] + k * (k - 1) / 2;
+    }
+  // Des blocs trop gros ne valent pas mieux que les tables complètes
+  if (self->table_start[self->nblocks] * BLOCK_TREE_SHARE > full
+      || !block_edges (self, b) || !block_tables (self)
+      || !block_walk (self) || !block_sparse (self))
+    {
+      block_tree_destroy (self);
+      return false;
+    }
+  return true;
+}
+
+void block_tree_destroy (block_tree *self)
+{
+  if (!self)
+    return;
+  free (self->start);
+  free (self->members);
+  free (self->home);
+  free (self->local);
+  free (self->down);
+  free (self->adj_start);
+  free (self->adj);
+  free (self->lengths);
+  free (self->table_start);
+  free (self->dist);
+  free (self->euler);
+  free (self->level);
+  free (self->first);
+  free (self->last);
+  free (self->sparse);
+  memset (self, 0, sizeof (*self));
+}
+
+/*
+ * Whether node x lies in the subtree of node y
+ */
+static inline bool in_subtree (const block_tree *self, size_t x, size_t y)
+{
+  return self->first[y] <= self->first[x] && self->first[x] <= self->last[y];
+}
+
+/*
+ * Child of node y on the way down to node x of its subtree
+ */
+static inline uint32_t child_towards (const block_tree *self, size_t y,
+                                      size_t x)
+{
+  return self->euler[lowest (self, self->first[y], self->first[x]) + 1];
+}
+
+/*
+ * Neighbor of u on a shortest path to v != u in the same component:
+ * the path leaves u through the block below it towards v, or else
+ * through the block above it, and crosses that block to the vertex of
+ * the block towards v
+ */
+static size_t first_hop (const block_tree *self, size_t u, size_t v)
+{
+  size_t n = self->size;
+  uint32_t b = self->home[u], i = self->local[u], j = 0;
+  if (in_subtree (self, v, u))
+    {
+      b = child_towards (self, u, v) - n;
+      i = 0;
+    }
+  if (in_subtree (self, v, n + b))
+    j = self->local[child_towards (self, n + b, v)];
+  size_t d = block_pair_dist (self, b, i, j), slot = self->start[b] + i;
+  for (size_t e = self->adj_start[slot]; e < self->adj_start[slot + 1]; e++)
+    {
+      size_t length = self->lengths ? self->lengths[e] : 1;
+      if (length + block_pair_dist (self, b, self->adj[e], j) == d)
+        return self->members[self->start[b] + self->adj[e]];
+    }
+  return INT_MAX;
+}
+
+size_t block_tree_dist (const block_tree *self, size_t source, size_t dest,
+                        size_t *next)
+{
+  if (next)
+    *next = source == dest ? source : INT_MAX;
+  if (source == dest)
+    return 0;
+  size_t n = self->size;
+  size_t fs = self->first[source], fd = self->first[dest];
+  size_t low = fs < fd ? fs : fd, high = fs < fd ? fd : fs;
+  size_t p = lowest (self, low, high);
+  uint32_t w = self->euler[p];
+  // Ancêtre commun au-dessus des composantes : pas de chemin
+  if (w == n + self->nblocks)
+    return INT_MAX;
+  size_t d;
+  if (w < n)
+    d = self->down[source] + self->down[dest] - 2 * self->down[w];
+  else
+    {
+      // Sommets du bloc commun par lesquels passent les deux chemins
+      uint32_t later = self->euler[p + 1];
+      uint32_t earlier = self->euler[lowest (self, self->first[w], low) + 1];
+      uint32_t cs = fs < fd ? earlier : later, cd = fs < fd ? later : earlier;
+      d = self->down[source] - self->down[cs]
+        + block_pair_dist (self, w - n, self->local[cs], self->local[cd])
+        + self->down[dest] - self->down[cd];
+    }
+  if (next)
+    *next = first_hop (self, source, dest);
+  return d;
+}
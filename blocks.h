@@ -0,0 +1,80 @@
+#ifndef BLOCKS_H
+#define BLOCKS_H
+
+#include "algo.h"
+
+/*
+ * Block-cut tree of a board: its blocks are the biconnected components,
+ * an edge alone for every bridge, so that a component that is a tree
+ * has blocks of two vertices only. The tree has a node for each vertex
+ * and each block, block b being node size + b: a block hangs below the
+ * cut vertex it was reached from, its head, and the other vertices of
+ * the block hang below it; a last node, size + nblocks, holds the first
+ * vertex of every component.
+ *
+ * Block b holds the vertices members[start[b]] .. members[start[b + 1]
+ * - 1], its head first. Every vertex v but the first of its component
+ * lies below a single block home[v], at index local[v] in it, and
+ * down[v] is its distance from that first vertex. The edges of vertex
+ * i of block b inside the block lead to the vertices of the block
+ * adj[e] for e = adj_start[start[b] + i] .. adj_start[start[b] + i + 1]
+ * - 1, of length lengths[e] (1 when lengths is NULL), and the distances
+ * inside block b are packed in dist from table_start[b], upper triangle
+ * without its diagonal.
+ *
+ * euler holds the nodes in the order of a depth-first walk of the tree,
+ * level their depth, first and last the first and last position of
+ * each node; sparse holds the position of the rightmost shallowest node
+ * of every run of 2^k spans of BLOCK_TREE_SPAN positions, so that the
+ * lowest common ancestor of two nodes is found in constant time.
+ *
+ * largest is the number of vertices of the largest block and trees the
+ * number of components that are trees.
+ */
+typedef struct block_tree
+{
+  size_t size;
+  size_t nblocks;
+  uint32_t *start;
+  uint32_t *members;
+  uint32_t *home;
+  uint32_t *local;
+  unsigned int *down;
+  uint32_t *adj_start;
+  uint32_t *adj;
+  uint32_t *lengths;
+  size_t *table_start;
+  unsigned int *dist;
+  uint32_t *euler;
+  uint32_t *level;
+  uint32_t *first;
+  uint32_t *last;
+  size_t tour_len;
+  uint32_t *sparse;
+  size_t spans;
+  size_t largest;
+  size_t trees;
+} block_tree;
+
+/*
+ * Find the blocks of a board and the distances inside each of them.
+ * Return false if memory is missing or if the tables of the blocks
+ * would hold more than a quarter of the pairs of the full tables.
+ */
+bool block_tree_build (block_tree * self, const board * b);
+
+/*
+ * Destroy a block-cut tree by freeing all memory used by its members
+ */
+void block_tree_destroy (block_tree * self);
+
+/*
+ * Length of a shortest path between source and dest, INT_MAX if they
+ * are not connected, in constant time: the blocks between them are
+ * crossed at their cut vertices. If next is not NULL store there the
+ * neighbor of source on such a path, source itself if source == dest.
+ */
+size_t block_tree_dist (const block_tree * self, size_t source, size_t dest,
+                        size_t *next);
+
+#endif // BLOCKS_H
@@ -0,0 +1,66 @@
+#include "algo.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Convert a text map into the binary map format read by
+ * board_read_binary, keeping the edge lengths with --weighted:
+ * ./convert map.txt [map.bin] [--weighted]
+ */
+int main (int argc, const char *argv[])
+{
+  bool weighted = argc > 1 && strcmp (argv[argc - 1], "--weighted") == 0;
+  if (weighted)
+    argc--;
+  if (argc != 2 && argc != 3)
+    {
+      fprintf (stderr, "Usage: ./convert map.txt [map.bin] [--weighted]\n");
+      exit (-1);
+    }
+
+  // Par défaut map.txt -> map.bin
+  const char *output = argv[2];
+  char *name = NULL;
+  if (argc == 2)
+    {
+      size_t len = strlen (argv[1]);
+      if (len > 4 && strcmp (argv[1] + len - 4, ".txt") == 0)
+        len -= 4;
+      name = malloc (len + 5);
+      memcpy (name, argv[1], len);
+      strcpy (name + len, ".bin");
+      output = name;
+    }
+
+  board b;
+  board_create (&b);
+  b.simplify = true;
+  b.weighted = weighted;
+  if (!board_load (&b, argv[1]))
+    {
+      fprintf (stderr, "Error parsing input file %s\n", argv[1]);
+      exit (-1);
+    }
+
+  FILE *file = fopen (output, "wb");
+  if (file == NULL)
+    {
+      fprintf (stderr, "Error opening output file %s\n", output);
+      exit (-1);
+    }
+  bool written = board_write_binary (&b, file);
+  if (fclose (file) != 0 || !written)
+    {
+      fprintf (stderr, "Error writing output file %s\n", output);
+      remove (output);
+      exit (-1);
+    }
+  if (b.removed_edges > 0)
+    fprintf (stderr, "Removed %zu duplicate edges or self-loops\n",
+             b.removed_edges);
+
+  board_destroy (&b);
+  free (name);
+  return 0;
+}
@@ -1,66 +1,85 @@
 #include "algo.h"
+#include "blocks.h"
+#include "hierarchy.h"
 
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/time.h>
 
+// Absence de sommet (pas de voisin possible, pas de cible)
+#define NO_VERTEX UINT32_MAX
+
 typedef struct
 {
-  board_vertex **positions;
+  uint32_t *positions;
   size_t size;
 } vector;
 
-static int min_dist_between_summit_and_all_cops (board * b, board_vertex * v,
-                                                 board_vertex ** cops,
+/*
+ * État propre à une partie : le plateau est partagé en lecture seule,
+ * tout ce qui change pendant un tour est rangé ici
+ */
+typedef struct
+{
+  const board *b;
+  bool *on_path;                // sommets du trajet prévu d'un gendarme
+  unsigned int *row;            // distances depuis un sommet, réutilisées
+} search_state;
+
+static int min_dist_between_summit_and_all_cops (const board * b,
+                                                 uint32_t v,
+                                                 const uint32_t * cops,
                                                  size_t ncops);
-static void place_cops (board * b, board_vertex ** out_pos, size_t k);
-static int score_pos_robber_for_one_summit (board * b, board_vertex * v,
-                                            board_vertex ** cops,
+static void place_cops (search_state * s, uint32_t * out_pos, size_t k);
+static int score_pos_robber_for_one_summit (const board * b, uint32_t v,
+                                            const uint32_t * cops,
                                             size_t ncops,
-                                            board_vertex ** robbers,
+                                            const uint32_t * robbers,
                                             size_t nrobbers);
-static void place_robbers (board * b, board_vertex ** out_pos, size_t k,
-                           board_vertex ** cops, size_t ncops);
-static int dist_moy_between_summit_and_all_cops (board * b, board_vertex * v,
-                                                 board_vertex ** cops,
+static void place_robbers (const board * b, uint32_t * out_pos, size_t k,
+                           const uint32_t * cops, size_t ncops);
+static int dist_moy_between_summit_and_all_cops (const board * b,
+                                                 uint32_t v,
+                                                 const uint32_t * cops,
                                                  size_t ncops);
-static int score_pos_cops_for_one_summit (board * b, board_vertex * v,
-                                          board_vertex ** cops, size_t ncops);
-static int dist_moy_between_summit_and_all_summits (board * b,
-                                                    board_vertex * v);
-static void move_cops (board * b, board_vertex ** out_pos, size_t k,
-                       board_vertex ** robbers, size_t nrobbers);
-static bool summit_is_occupied (board_vertex * v, board_vertex ** role,
+static int score_pos_cops_for_one_summit (search_state * s, uint32_t v,
+                                          const uint32_t * cops,
+                                          size_t ncops);
+static int dist_moy_between_summit_and_all_summits (search_state * s,
+                                                    uint32_t v);
+static void move_cops (search_state * s, uint32_t * cops, size_t ncops,
+                       const uint32_t * robbers, size_t nrobbers);
+static bool summit_is_occupied (uint32_t v, const uint32_t * role,
                                 size_t nOfRole);
-static int score_move_robber_for_one_neighbor (board * b, board_vertex * v,
-                                               board_vertex ** robbers,
+static int score_move_robber_for_one_neighbor (search_state * s, uint32_t v,
+                                               const uint32_t * robbers,
                                                size_t nrobbers,
-                                               board_vertex ** cops,
+                                               const uint32_t * cops,
                                                size_t ncops);
-static int is_in_tab (board_vertex ** tab, size_t n, board_vertex * v);
-static board_vertex *get_best_candidate (board_vertex ** candidates,
-                                         size_t *votes, size_t n_candidates,
-                                         board_vertex ** cops, size_t ncops,
-                                         board * b);
-static board_vertex *get_target (board * b, board_vertex ** cops,
-                                 size_t ncops, board_vertex ** robbers,
-                                 size_t nrobbers);
-static board_vertex *get_board_vertex_from_index (board * b, size_t index);
-static board_vertex *get_2nd_best_neighbor (board * b, board_vertex * start,
-                                            board_vertex ** used_positions,
-                                            size_t n_used_positions,
-                                            board_vertex * target);
-static int dist_moy_between_summit_and_all_robbers (board * b,
-                                                    board_vertex * v,
-                                                    board_vertex ** robbers,
+static int is_in_tab (const uint32_t * tab, size_t n, uint32_t v);
+static uint32_t get_best_candidate (const uint32_t * candidates,
+                                    size_t *votes, size_t n_candidates,
+                                    const uint32_t * cops, size_t ncops,
+                                    const board * b);
+static uint32_t get_target (const board * b, const uint32_t * cops,
+                            size_t ncops, const uint32_t * robbers,
+                            size_t nrobbers);
+static uint32_t get_2nd_best_neighbor (const search_state * s,
+                                       uint32_t start,
+                                       const uint32_t * used_positions,
+                                       size_t n_used_positions,
+                                       uint32_t target);
+static int dist_moy_between_summit_and_all_robbers (const board * b,
+                                                    uint32_t v,
+                                                    const uint32_t * robbers,
                                                     size_t nrobbers);
-static void initialize_path_of_cops (board * b);
-static void mark_path_of_cops (board * b, board_vertex * start,
-                               board_vertex * target);
-static void free_path_cops (board * b);
-static int get_nb_of_same_summits (board * b, board_vertex * start,
-                                   board_vertex * target);
+static void initialize_path_of_cops (search_state * s);
+static void mark_path_of_cops (search_state * s, uint32_t start,
+                               uint32_t target);
+static int get_nb_of_same_summits (const search_state * s, uint32_t start,
+                                   uint32_t target);
 
 #include <stdarg.h>
 void debug (const char *format, ...)
@@ -148,31 +167,39 @@ void vector_remove_at (vector *self, size_t index)
   self->size--;
 }
 
-void vector_print (vector *self)
+void vector_print (vector *self, const board *b)
 {
   if (self == NULL)
     return;
   for (size_t i = 0; i < self->size; i++)
     {
-      printf ("%zu\n", self->positions[i]->index);
+      printf ("%zu\n", board_external_index (b, self->positions[i]));
     }
   fflush (stdout);
 }
 
 typedef struct
 {
-  board b;
+  const board *b;
+  search_state s;
   vector cops;
   vector robbers;
   size_t remaining_turn;
   enum role r;
 } game;
 
-void game_create (game *self)
+/*
+ * Create a game on a board prepared with board_prepare, which the game
+ * only reads and does not own
+ */
+void game_create (game *self, const board *b)
 {
   if (self == NULL)
     return;
-  board_create (&(self->b));
+  self->b = b;
+  self->s.b = b;
+  self->s.on_path = calloc (b->size, sizeof (*self->s.on_path));
+  self->s.row = malloc (b->size * sizeof (*self->s.row));
   vector_create (&(self->cops));
   vector_create (&(self->robbers));
   self->remaining_turn = 0;
@@ -183,7 +210,8 @@ void game_destroy (game *self)
 {
   if (self == NULL)
     return;
-  board_destroy (&(self->b));
+  free (self->s.on_path);
+  free (self->s.row);
   vector_destroy (&(self->cops));
   vector_destroy (&(self->robbers));
 }
@@ -199,8 +227,7 @@ void game_update_position (game *self, size_t *new)
     {
       // Check if moves are valid
       for (size_t i = 0; i < current->size; i++)
-        if (!board_is_valid_move (&(self->b), current->positions[i]->index,
-                                  new[i]))
+        if (!board_is_valid_move (self->b, current->positions[i], new[i]))
           {
             fprintf (stderr, "New position is invalid\n");
             exit (1);
@@ -210,7 +237,12 @@ void game_update_position (game *self, size_t *new)
     current->positions = calloc (current->size, sizeof (*current->positions));
   for (size_t i = 0; i < current->size; i++)
     {
-      current->positions[i] = self->b.vertices[new[i]];
+      if (new[i] >= self->b->size)
+        {
+          fprintf (stderr, "New position is invalid\n");
+          exit (1);
+        }
+      current->positions[i] = new[i];
     }
 }
 
@@ -221,17 +253,15 @@ void game_update_position (game *self, size_t *new)
  * out_pos[]  : tableau (déjà alloué) qui recevra les k positions
  * k : nombre de gendarmes à placer
  * -------------------------------------------------------------------*/
-static void place_cops (board *b, board_vertex **out_pos, size_t k)
+static void place_cops (search_state *s, uint32_t *out_pos, size_t k)
 {
-  if (!b->dist)
-    board_Floyd_Warshall (b);
-
+  const board *b = s->b;
   // Cas où y a moins de case que de gendarmes
   if (b->size <= k)
     {
       for (size_t i = 0; i < k; i++)
         {
-          out_pos[i] = b->vertices[i % b->size];
+          out_pos[i] = i % b->size;
         }
       return;
     }
@@ -250,7 +280,7 @@ static void place_cops (board *b, board_vertex **out_pos, size_t k)
             continue;
 
           int score =
-            score_pos_cops_for_one_summit (b, b->vertices[j], out_pos, i);
+            score_pos_cops_for_one_summit (s, j, out_pos, i);
           if (score > best_score)
             {
               best_score = score;
@@ -260,26 +290,22 @@ static void place_cops (board *b, board_vertex **out_pos, size_t k)
 
       if (best_idx != -1)
         {
-          out_pos[i] = b->vertices[best_idx];
+          out_pos[i] = best_idx;
           selected[best_idx] = true;
         }
     }
   free (selected);
 }
 
-static void place_robbers (board *b, board_vertex **out_pos, size_t k,
-                           board_vertex **cops, size_t ncops)
+static void place_robbers (const board *b, uint32_t *out_pos, size_t k,
+                           const uint32_t *cops, size_t ncops)
 {
-  /* -- 1) S’assurer que l’on dispose des distances -- */
-  if (!b->dist)                 /* dist==NULL → pas encore calculé  */
-    board_Floyd_Warshall (b);   /* calcule dist[][] et next[][]     */
-
   // Cas où y a moins de case que de voleurs
   if (b->size <= k)
     {
       for (size_t i = 0; i < k; i++)
         {
-          out_pos[i] = b->vertices[i % b->size];
+          out_pos[i] = i % b->size;
         }
 
       return;
@@ -298,7 +324,7 @@ static void place_robbers (board *b, board_vertex **out_pos, size_t k,
             continue;
 
           int score =
-            score_pos_robber_for_one_summit (b, b->vertices[j], cops,
+            score_pos_robber_for_one_summit (b, j, cops,
                                              ncops, out_pos, i);
 
           if (score > best_score)
@@ -310,29 +336,25 @@ static void place_robbers (board *b, board_vertex **out_pos, size_t k,
 
       if (best_idx != -1)
         {
-          out_pos[i] = b->vertices[best_idx];
+          out_pos[i] = best_idx;
           selected[best_idx] = true;
         }
     }
   free (selected);
 }
 
-static void move_cops (board *b, board_vertex **cops, size_t ncops,
-                       board_vertex **robbers, size_t nrobbers)
+static void move_cops (search_state *s, uint32_t *cops, size_t ncops,
+                       const uint32_t *robbers, size_t nrobbers)
 {
-  /* -- 1) S’assurer que l’on dispose des distances -- */
-  if (!b->dist)
-    {                           /* dist==NULL → pas encore calculé  */
-      board_Floyd_Warshall (b); /* calcule dist[][] et next[][]     */
-    }
+  const board *b = s->b;
   // ne pas prendre les gendarmes qui ne peuvent pas bougé
-  board_vertex **real_cops = malloc (ncops * sizeof (board_vertex *));
+  uint32_t *real_cops = malloc (ncops * sizeof (uint32_t));
   int *num_real_cops = calloc (ncops, sizeof (int));
   size_t n_real_cops = 0;
   for (size_t i = 0; i < ncops; i++)
     {                           // TODO: il faudrait que le dernier
       // prenne completement un autre chemin
-      if (cops[i]->degree > 0)
+      if (board_degree (b, cops[i]) > 0)
         {
           num_real_cops[i] = i;
           real_cops[n_real_cops++] = cops[i];
@@ -343,32 +365,33 @@ static void move_cops (board *b, board_vertex **cops, size_t ncops,
         }
     }
 
-  initialize_path_of_cops (b);
+  initialize_path_of_cops (s);
 
   // Récupérer le voleur cible
-  board_vertex *target =
-    get_target (b, real_cops, n_real_cops, robbers, nrobbers);
+  uint32_t target = get_target (b, real_cops, n_real_cops, robbers,
+                                nrobbers);
+  // Aucun voleur atteignable : les gendarmes restent sur place
+  if (target == NO_VERTEX)
+    n_real_cops = 0;
 
   // tableau qui enregistre les positions pour ne pas que deux gendarmes se
   // retrouve sur la meme case
-  board_vertex **used_positions =
-    malloc (n_real_cops * sizeof (board_vertex *));
+  uint32_t *used_positions = malloc (n_real_cops * sizeof (uint32_t));
   size_t n_used_positions = 0;
 
   // Deplacer tout les gendarmes en direction de la cible
   // L'algo essaye de ne pas placer 2 gendarmes sur la meme case
   for (size_t i = 0; i < n_real_cops; i++)
     {
-      size_t index_next = board_next (b, real_cops[i]->index, target->index);
-      board_vertex *res = get_board_vertex_from_index (b, index_next);
+      uint32_t res = board_next (b, real_cops[i], target);
       if (is_in_tab (used_positions, n_used_positions, res) != -1)
         {
           // Si la position est deja prise on regarde les voisins et on prend
           // la meilleur
           real_cops[i] =
-            get_2nd_best_neighbor (b, real_cops[i], used_positions,
+            get_2nd_best_neighbor (s, real_cops[i], used_positions,
                                    n_used_positions, target);
-          if (!real_cops[i])
+          if (real_cops[i] == NO_VERTEX)
             {
               real_cops[i] = res;
             }
@@ -377,7 +400,7 @@ static void move_cops (board *b, board_vertex **cops, size_t ncops,
         {
           real_cops[i] = res;
         }
-      mark_path_of_cops (b, real_cops[i], target);
+      mark_path_of_cops (s, real_cops[i], target);
       used_positions[n_used_positions] = real_cops[i];
       n_used_positions++;
     }
@@ -389,40 +412,39 @@ static void move_cops (board *b, board_vertex **cops, size_t ncops,
           cops[num_real_cops[i]] = real_cops[i];
         }
     }
-  free_path_cops (b);
   free (real_cops);
   free (num_real_cops);
   free (used_positions);
 }
 
-static void move_robbers (board *b, board_vertex **robbers, size_t nrobbers,
-                          board_vertex **cops, size_t ncops)
+static void move_robbers (search_state *s, uint32_t *robbers,
+                          size_t nrobbers, const uint32_t *cops,
+                          size_t ncops)
 {
-  /* -- 1) S’assurer que l’on dispose des distances -- */
-  if (!b->dist)                 /* dist==NULL → pas encore calculé  */
-    board_Floyd_Warshall (b);   /* calcule dist[][] et next[][]     */
+  const board *b = s->b;
   int score = 0;
   // Pour chaque position de gendarmes -> cops[i]
   for (size_t i = 0; i < nrobbers; i++)
     {
-      board_vertex *best_move = NULL;
+      uint32_t best_move = NO_VERTEX;
       int best_score = INT_MIN;
+      const uint32_t *neighbors = board_neighbors (b, robbers[i]);
 
       // on boucle sur les voisins + la case actuelle
-      for (size_t j = 0; j < robbers[i]->degree + 1; j++)
+      for (size_t j = 0; j < board_degree (b, robbers[i]) + 1; j++)
         {
-          board_vertex *candidate;
+          uint32_t candidate;
 
-          if (j == robbers[i]->degree)
+          if (j == board_degree (b, robbers[i]))
             {
               candidate = robbers[i];   // rester sur place
             }
           else
             {
-              candidate = robbers[i]->neighbors[j];
+              candidate = neighbors[j];
             }
 
-          score = score_move_robber_for_one_neighbor (b, candidate, robbers,
+          score = score_move_robber_for_one_neighbor (s, candidate, robbers,
                                                       nrobbers, cops, ncops);
 
           if (score > best_score)
@@ -436,48 +458,36 @@ static void move_robbers (board *b, board_vertex **robbers, size_t nrobbers,
     }
 }
 
-static void initialize_path_of_cops (board *b)
-{
-  for (size_t i = 0; i < b->size; i++)
-    {
-      b->vertices[i]->optim = malloc (sizeof (bool));
-      b->vertices[i]->optim[0] = false;
-    }
-}
-
-static void free_path_cops (board *b)
+static void initialize_path_of_cops (search_state *s)
 {
-  for (size_t i = 0; i < b->size; i++)
-    {
-      free (b->vertices[i]->optim);
-    }
+  memset (s->on_path, 0, s->b->size * sizeof (*s->on_path));
 }
 
-static void mark_path_of_cops (board *b, board_vertex *start,
-                               board_vertex *target)
+static void mark_path_of_cops (search_state *s, uint32_t start,
+                               uint32_t target)
 {
-  size_t dist = board_dist (b, start->index, target->index);
-  board_vertex *actual = start;
+  const board *b = s->b;
+  size_t dist = board_dist (b, start, target);
+  uint32_t actual = start;
   for (size_t i = 0; i < dist; i++)
     {
-      actual->optim[0] = true;
+      s->on_path[actual] = true;
       // Récupérer le prochain sommet du trajet
-      actual =
-        get_board_vertex_from_index (b,
-                                     board_next (b, actual->index,
-                                                 target->index));
+      actual = board_next (b, actual, target);
     }
 }
 
-static board_vertex *get_2nd_best_neighbor (board *b, board_vertex *start,
-                                            board_vertex **used_positions,
-                                            size_t n_used_positions,
-                                            board_vertex *target)
+static uint32_t get_2nd_best_neighbor (const search_state *s,
+                                       uint32_t start,
+                                       const uint32_t *used_positions,
+                                       size_t n_used_positions,
+                                       uint32_t target)
 {
+  const board *b = s->b;
   // Si pas d'autre possibilité on va quand meme sur la meme case
-  if (start->degree == 1)
+  if (board_degree (b, start) == 1)
     {
-      return NULL;
+      return NO_VERTEX;
     }
 
   const int W_DIST = 8;         // importance de la distance entre le voisin et la cible
@@ -487,19 +497,20 @@ static board_vertex *get_2nd_best_neighbor (board *b, board_vertex *start,
 
   // Sinon on choisit la case voisine (ou la case start) où la distance avec
   // le gendarme est la plus proche
-  board_vertex *best_neighbor = NULL;
+  uint32_t best_neighbor = NO_VERTEX;
   int best_score = INT_MAX;
-  board_vertex *current = NULL;
-  for (size_t i = 0; i < start->degree; i++)
+  uint32_t current = NO_VERTEX;
+  const uint32_t *neighbors = board_neighbors (b, start);
+  for (size_t i = 0; i < board_degree (b, start); i++)
     {
-      current = start->neighbors[i];
+      current = neighbors[i];
       if (is_in_tab (used_positions, n_used_positions, current) != -1)
         {
           current = start;
         }
 
-      int score = board_dist (b, current->index, target->index) * W_DIST +
-        get_nb_of_same_summits (b, current, target) * W_SAME_PATH;
+      int score = board_dist (b, current, target) * W_DIST +
+        get_nb_of_same_summits (s, current, target) * W_SAME_PATH;
       if (score < best_score)
         {
           best_score = score;
@@ -512,43 +523,30 @@ static board_vertex *get_2nd_best_neighbor (board *b, board_vertex *start,
 // Compte le nombre de sommet commun entre ceux deja utilisé par d'autres
 // gendarme et ceux que le gendarme a prevu de prendre si il va sur start (un de
 // ses voisins)
-static int get_nb_of_same_summits (board *b, board_vertex *start,
-                                   board_vertex *target)
+static int get_nb_of_same_summits (const search_state *s, uint32_t start,
+                                   uint32_t target)
 {
+  const board *b = s->b;
   int nb = 0;
-  board_vertex *current = start;
-  for (size_t i = 0; i < board_dist (b, current->index, target->index); i++)
+  uint32_t current = start;
+  for (size_t i = 0; i < board_dist (b, current, target); i++)
     {
-      if (current->optim[0])
+      if (s->on_path[current])
         {
           nb++;
         }
-      current =
-        get_board_vertex_from_index (b,
-                                     board_next (b, current->index,
-                                                 target->index));
+      current = board_next (b, current, target);
     }
   return nb;
 }
 
-static board_vertex *get_board_vertex_from_index (board *b, size_t index)
-{
-  for (size_t i = 0; i < b->size; i++)
-    {
-      if (b->vertices[i]->index == index)
-        {
-          return b->vertices[i];
-        }
-    }
-  return NULL;
-}
-
 // retourne le voleur à prendre pour cible pour tout les gendarmes
 // on prend le voleur le plus proche de la majorité des gendarmes
 // si yen a plusieurs, on prend le voleur dont la distance moyenne avec tout les
 // gendarmes est la plus faible
-static board_vertex *get_target (board *b, board_vertex **cops, size_t ncops,
-                                 board_vertex **robbers, size_t nrobbers)
+static uint32_t get_target (const board *b, const uint32_t *cops,
+                            size_t ncops, const uint32_t *robbers,
+                            size_t nrobbers)
 {
   // pour chaque gendarme, définir le voleur le plus proche
   // target = le plus proche pour la majorité des gendarmes
@@ -556,7 +554,7 @@ static board_vertex *get_target (board *b, board_vertex **cops, size_t ncops,
   // gendarmes est la plus faible
 
   // Création d'un tableau de voleur candidat
-  board_vertex **candidates = malloc (ncops * sizeof (board_vertex *));
+  uint32_t *candidates = malloc (ncops * sizeof (uint32_t));
   size_t n_candidates = 0;
   size_t *votes = calloc (ncops, sizeof (size_t));
 
@@ -564,10 +562,10 @@ static board_vertex *get_target (board *b, board_vertex **cops, size_t ncops,
     {                           // pour chaque gendarme
       // trouver le voleur le plus proche
       int min_dist = INT_MAX;
-      board_vertex *target = NULL;
+      uint32_t target = NO_VERTEX;
       for (size_t j = 0; j < nrobbers; j++)
         {
-          int dist = board_dist (b, cops[i]->index, robbers[j]->index);
+          int dist = board_dist (b, cops[i], robbers[j]);
           if (dist < min_dist)
             {
               min_dist = dist;
@@ -594,7 +592,7 @@ static board_vertex *get_target (board *b, board_vertex **cops, size_t ncops,
     }
 
   // On récupère le voleur le plus proche de la majorité des gendarmes
-  board_vertex *best_candidate =
+  uint32_t best_candidate =
     get_best_candidate (candidates, votes, n_candidates, cops, ncops, b);
 
   free (candidates);
@@ -608,10 +606,10 @@ static board_vertex *get_target (board *b, board_vertex **cops, size_t ncops,
 // la majorité des gendarmes si il y a égalité, on prend le voleur dont la
 // distance moyenne avec tout les gendarmes est la plus faible
 // Si il y a un seule candidat le plus proche, on le retourne
-static board_vertex *get_best_candidate (board_vertex **candidates,
-                                         size_t *votes, size_t n_candidates,
-                                         board_vertex **cops, size_t ncops,
-                                         board *b)
+static uint32_t get_best_candidate (const uint32_t *candidates,
+                                    size_t *votes, size_t n_candidates,
+                                    const uint32_t *cops, size_t ncops,
+                                    const board *b)
 {
   // On cherche le voleur le plus proche des gendarmes
   size_t max_count = 0;
@@ -624,8 +622,7 @@ static board_vertex *get_best_candidate (board_vertex **candidates,
     }
   // On compte combien de voleurs ont le même score
   // et on les met dans un tableau
-  board_vertex **best_candidates =
-    malloc (n_candidates * sizeof (board_vertex *));
+  uint32_t *best_candidates = malloc (n_candidates * sizeof (uint32_t));
   size_t n_best_candidates = 0;
   for (size_t i = 0; i < n_candidates; i++)
     {
@@ -640,14 +637,14 @@ static board_vertex *get_best_candidate (board_vertex **candidates,
   // plusieurs candidats)
   if (n_best_candidates == 1)
     {
-      board_vertex *final_target = best_candidates[0];
+      uint32_t final_target = best_candidates[0];
       free (best_candidates);
       return final_target;
     }
   else
     {
       int best_avg = INT_MAX;
-      board_vertex *best_candidate_avg = NULL;
+      uint32_t best_candidate_avg = NO_VERTEX;
       for (size_t i = 0; i < n_best_candidates; i++)
         {
           int avg =
@@ -665,11 +662,11 @@ static board_vertex *get_best_candidate (board_vertex **candidates,
 }
 
 // retourne -1 si pas dans tab, sinon retourne l'index
-static int is_in_tab (board_vertex **tab, size_t n, board_vertex *v)
+static int is_in_tab (const uint32_t *tab, size_t n, uint32_t v)
 {
   for (size_t i = 0; i < n; i++)
     {
-      if (tab[i]->index == v->index)
+      if (tab[i] == v)
         {
           return i;
         }
@@ -677,12 +674,13 @@ static int is_in_tab (board_vertex **tab, size_t n, board_vertex *v)
   return -1;
 }
 
-static int score_move_robber_for_one_neighbor (board *b, board_vertex *v,
-                                               board_vertex **robbers,
+static int score_move_robber_for_one_neighbor (search_state *s, uint32_t v,
+                                               const uint32_t *robbers,
                                                size_t nrobbers,
-                                               board_vertex **cops,
+                                               const uint32_t *cops,
                                                size_t ncops)
 {
+  const board *b = s->b;
   /* Poids (peut etre a ajuster) */
   const int W_DIST_MAX = 10;    // distance_maximale (Éloignement des autres gendarmes déjà placés)
   const int W_DEGREE = 1;       // mobilité
@@ -690,8 +688,8 @@ static int score_move_robber_for_one_neighbor (board *b, board_vertex *v,
   const int PENALITY = 13;      // si case deja occupée par un voleur (but = dispersé)
 
   int dist_min = min_dist_between_summit_and_all_cops (b, v, cops, ncops);
-  int degree = v->degree;
-  int dist_moy = dist_moy_between_summit_and_all_summits (b, v);
+  int degree = board_degree (b, v);
+  int dist_moy = dist_moy_between_summit_and_all_summits (s, v);
   int penality = summit_is_occupied (v, robbers, nrobbers) ? -PENALITY : 0;
 
   /* Score pondéré */
@@ -701,9 +699,11 @@ static int score_move_robber_for_one_neighbor (board *b, board_vertex *v,
   return score;
 }
 
-static int score_pos_cops_for_one_summit (board *b, board_vertex *v,
-                                          board_vertex **cops, size_t ncops)
+static int score_pos_cops_for_one_summit (search_state *s, uint32_t v,
+                                          const uint32_t *cops,
+                                          size_t ncops)
 {
+  const board *b = s->b;
   /* Poids (peut etre a ajuster) */
   const int W_DIST_MAX = 1;     // distance_maximale (Éloignement des autres gendarmes déjà placés)
 
@@ -711,8 +711,8 @@ static int score_pos_cops_for_one_summit (board *b, board_vertex *v,
   const int W_DIST_MOY = 6;     // Moyenne des distances vers tous les sommets
 
   int dist_min = min_dist_between_summit_and_all_cops (b, v, cops, ncops);
-  int degree = v->degree;
-  int dist_moy = dist_moy_between_summit_and_all_summits (b, v);
+  int degree = board_degree (b, v);
+  int dist_moy = dist_moy_between_summit_and_all_summits (s, v);
 
   /* Score pondéré */
   int score =
@@ -728,9 +728,10 @@ static int score_pos_cops_for_one_summit (board *b, board_vertex *v,
  *  cops[]     : tableau des positions des gendarmes
  *  ncops      : nombre de gendarmes
  * -------------------------------------------------------------------*/
-static int score_pos_robber_for_one_summit (board *b, board_vertex *v,
-                                            board_vertex **cops, size_t ncops,
-                                            board_vertex **robbers,
+static int score_pos_robber_for_one_summit (const board *b, uint32_t v,
+                                            const uint32_t *cops,
+                                            size_t ncops,
+                                            const uint32_t *robbers,
                                             size_t nrobbers)
 {
   /* Poids (peut etre a ajuster) */
@@ -740,7 +741,7 @@ static int score_pos_robber_for_one_summit (board *b, board_vertex *v,
   const int W_DIST_MOY_WITH_ROBBERS = 7;        // dispersé les gendarmes
 
   int dist_min = min_dist_between_summit_and_all_cops (b, v, cops, ncops);
-  int degree = v->degree;
+  int degree = board_degree (b, v);
   int dist_moy = dist_moy_between_summit_and_all_cops (b, v, cops, ncops);
   int dist_moy_with_robber =
     dist_moy_between_summit_and_all_robbers (b, v, robbers, nrobbers);
@@ -751,15 +752,17 @@ static int score_pos_robber_for_one_summit (board *b, board_vertex *v,
   return score;
 }
 
-static int dist_moy_between_summit_and_all_robbers (board *b, board_vertex *v,
-                                                    board_vertex **robbers,
+static int dist_moy_between_summit_and_all_robbers (const board *b,
+                                                    uint32_t v,
+                                                    const uint32_t *robbers,
                                                     size_t nrobbers)
 {
   return dist_moy_between_summit_and_all_cops (b, v, robbers, nrobbers);
 }
 
-static int min_dist_between_summit_and_all_cops (board *b, board_vertex *v,
-                                                 board_vertex **cops,
+static int min_dist_between_summit_and_all_cops (const board *b,
+                                                 uint32_t v,
+                                                 const uint32_t *cops,
                                                  size_t ncops)
 {
   if (ncops == 0)
@@ -767,9 +770,30 @@ static int min_dist_between_summit_and_all_cops (board *b, board_vertex *v,
       return INT_MAX;
     }
   int min_dist = INT_MAX;
+  // Bornes des repères d'abord : seuls les gendarmes dont la borne
+  // inférieure bat encore la plus petite borne supérieure sont cherchés
+  if (b->landmarks)
+    {
+      size_t best = INT_MAX, lower, upper;
+      for (size_t j = 0; j < ncops; j++)
+        {
+          board_dist_bounds (b, v, cops[j], &lower, &upper);
+          best = upper < best ? upper : best;
+        }
+      for (size_t j = 0; j < ncops; j++)
+        {
+          board_dist_bounds (b, v, cops[j], &lower, &upper);
+          if (lower < best)
+            {
+              size_t d = board_dist_within (b, v, cops[j], best - 1);
+              best = d < best ? d : best;
+            }
+        }
+      return best;
+    }
   for (size_t j = 0; j < ncops; j++)
     {
-      int d = b->dist[v->index][cops[j]->index];
+      int d = board_dist (b, v, cops[j]);
       if (d < min_dist)
         {
           min_dist = d;
@@ -778,29 +802,45 @@ static int min_dist_between_summit_and_all_cops (board *b, board_vertex *v,
   return min_dist;
 }
 
-static int dist_moy_between_summit_and_all_summits (board *b, board_vertex *v)
+static int dist_moy_between_summit_and_all_summits (search_state *s,
+                                                    uint32_t v)
 {
-  return dist_moy_between_summit_and_all_cops (b, v, b->vertices, b->size);
+  const board *b = s->b;
+  int total_dist = 0;
+  // Ligne entière d'un coup dans la ligne de la partie, sinon distance
+  // par distance
+  if (s->row && board_dist_row (b, v, s->row))
+    for (size_t j = 0; j < b->size; j++)
+      {
+        total_dist += s->row[j];
+      }
+  else
+    for (size_t j = 0; j < b->size; j++)
+      {
+        total_dist += board_dist (b, v, j);
+      }
+  return total_dist / b->size;
 }
 
-static int dist_moy_between_summit_and_all_cops (board *b, board_vertex *v,
-                                                 board_vertex **cops,
+static int dist_moy_between_summit_and_all_cops (const board *b,
+                                                 uint32_t v,
+                                                 const uint32_t *cops,
                                                  size_t ncops)
 {
   int total_dist = 0;
   for (size_t j = 0; j < ncops; j++)
     {
-      total_dist += b->dist[v->index][cops[j]->index];
+      total_dist += board_dist (b, v, cops[j]);
     }
   return total_dist / ncops;
 }
 
-static bool summit_is_occupied (board_vertex *v, board_vertex **role,
+static bool summit_is_occupied (uint32_t v, const uint32_t *role,
                                 size_t nOfRole)
 {
   for (size_t i = 0; i < nOfRole; i++)
     {
-      if (v->index == role[i]->index)
+      if (v == role[i])
         {
           return true;
         }
@@ -823,12 +863,12 @@ vector *game_next_position (game *self)
       // Compute initial positions
       if (self->r == COPS)
         {                       /* placement (ou repositionnement) gendarmes */
-          place_cops (&(self->b), current->positions, current->size);
+          place_cops (&(self->s), current->positions, current->size);
         }
       else
         {
           /* placement des voleurs */
-          place_robbers (&(self->b), current->positions, current->size,
+          place_robbers (self->b, current->positions, current->size,
                          self->cops.positions, self->cops.size);
         }
 
@@ -838,12 +878,12 @@ vector *game_next_position (game *self)
   if (self->r == COPS)
     {                           // deplacement des gendarmes
       /* current->positions[i]  */
-      move_cops (&(self->b), current->positions, current->size,
+      move_cops (&(self->s), current->positions, current->size,
                  self->robbers.positions, self->robbers.size);
     }
   else
     {                           // deplacement des voleurs
-      move_robbers (&(self->b), current->positions, current->size,
+      move_robbers (&(self->s), current->positions, current->size,
                     self->cops.positions, self->cops.size);
     }
   return current;
@@ -862,14 +902,15 @@ size_t game_capture_robbers (game *self)
       if (self->robbers.positions[i] == self->cops.positions[j])
         {
           fprintf (stderr, "Captured robber at position %zu\n",
-                   self->robbers.positions[i]->index);
+                   board_external_index (self->b,
+                                         self->robbers.positions[i]));
           vector_remove_at (&(self->robbers), i);
           return game_capture_robbers (self);
         }
   return self->robbers.size;
 }
 
-size_t *read_positions (size_t len)
+size_t *read_positions (size_t len, const board *b)
 {
   size_t *pos = calloc (len, sizeof (*pos));
   for (size_t i = 0; i < len; i++)
@@ -881,49 +922,136 @@ size_t *read_positions (size_t len)
           fprintf (stderr, "Error while reading new positions\n");
           exit (1);
         }
+      // Indices du fichier -> indices internes (carte renumérotée)
+      pos[i] = pos[i] < b->size ? board_internal_index (b, pos[i]) : pos[i];
     }
   return pos;
 }
 
+/*
+ * Board whose shared tables must be released when the game ends
+ * through exit (), as it does once the server closes its input
+ */
+static board *shared_board = NULL;
+
+static void release_shared_board (void)
+{
+  if (shared_board)
+    board_destroy (shared_board);
+}
+
 int main (int argc, const char *argv[])
 {
   struct timeval t1;
   gettimeofday (&t1, NULL);
   srand (t1.tv_usec * t1.tv_sec);
-  // Initialize game
-  game g;
-  game_create (&g);
-
   // Initialize data structures
-  if (argc != 3)
+  if (argc < 3)
     {
-      fprintf (stderr,
-               "Incorrect number of arguments: ./game filename 0/1\n");
+      fprintf (stderr, "Incorrect number of arguments: ./game filename 0/1"
+               " [--reorder] [--msbfs | --floyd-warshall]"
+               " [--dist-cache-mb N] [--landmarks K] [--dist-cache-dir DIR]"
+               " [--shared-tables] [--hierarchy [--hierarchy-file F]]"
+               " [--blocks]\n");
       exit (-1);
     }
-  FILE *file = fopen (argv[1], "r");
-  if (file == NULL)
+  bool reorder = false;
+  enum board_apsp apsp = BOARD_APSP_BFS;
+  size_t cache_mb = 0, landmarks = 0;
+  // Répertoire des tables déjà calculées, le serveur ne passant que la
+  // carte et le rôle
+  const char *cache_dir = getenv ("GAME_DIST_CACHE");
+  // Tables en mémoire partagée entre les parties simultanées
+  const char *shared = getenv ("GAME_SHARED_TABLES");
+  bool share = shared && *shared && strcmp (shared, "0") != 0;
+  bool contract = false, blocks = false;
+  const char *hierarchy_file = NULL;
+  for (int i = 3; i < argc; i++)
     {
-      fprintf (stderr, "Error opening input file");
-      exit (-1);
+      if (strcmp (argv[i], "--reorder") == 0)
+        reorder = true;
+      else if (strcmp (argv[i], "--msbfs") == 0)
+        apsp = BOARD_APSP_MSBFS;
+      else if (strcmp (argv[i], "--floyd-warshall") == 0)
+        apsp = BOARD_APSP_FLOYD_WARSHALL;
+      else if (strcmp (argv[i], "--dist-cache-mb") == 0 && i + 1 < argc
+               && atoi (argv[i + 1]) > 0)
+        cache_mb = atoi (argv[++i]);
+      else if (strcmp (argv[i], "--landmarks") == 0 && i + 1 < argc
+               && atoi (argv[i + 1]) > 0)
+        landmarks = atoi (argv[++i]);
+      else if (strcmp (argv[i], "--dist-cache-dir") == 0 && i + 1 < argc)
+        cache_dir = argv[++i];
+      else if (strcmp (argv[i], "--shared-tables") == 0)
+        share = true;
+      else if (strcmp (argv[i], "--hierarchy") == 0)
+        contract = true;
+      else if (strcmp (argv[i], "--hierarchy-file") == 0 && i + 1 < argc)
+        hierarchy_file = argv[++i];
+      else if (strcmp (argv[i], "--blocks") == 0)
+        blocks = true;
+      else
+        {
+          fprintf (stderr, "Unknown option %s\n", argv[i]);
+          exit (-1);
+        }
     }
-  bool success = board_read_from (&(g.b), file);
-  fclose (file);
+  board b;
+  board_create (&b);
+  b.simplify = true;
+  b.apsp = apsp;
+  // Lignes de distances à la demande plutôt que toutes les tables
+  b.dist_cache_bytes = cache_mb << 20;
+  // Ou bornes des repères et recherches bidirectionnelles
+  b.landmark_count = landmarks;
+  b.dist_cache_dir = cache_dir && *cache_dir ? cache_dir : NULL;
+  b.share_tables = share;
+  // Ou requêtes dans la hiérarchie de contraction, relue si possible
+  b.contract = contract;
+  b.hierarchy_file = hierarchy_file;
+  // Ou arbre des blocs, si les blocs sont petits
+  b.blocks = blocks;
+  // Carte binaire produite par ./convert, sinon carte texte
+  bool success = board_read_binary (&b, argv[1]) || board_load (&b, argv[1]);
   if (!success)
     {
       fprintf (stderr, "Error parsing input file");
       exit (-1);
     }
-  g.cops.size = g.b.cops;
-  g.robbers.size = g.b.robbers;
+  if (reorder && !board_reorder (&b))
+    {
+      fprintf (stderr, "Error reordering vertices");
+      exit (-1);
+    }
+  if (b.removed_edges > 0)
+    fprintf (stderr, "Removed %zu duplicate edges or self-loops\n",
+             b.removed_edges);
+  // Tout est calculé ici, ensuite le plateau n'est plus que lu
+  if (!board_prepare (&b))
+    {
+      fprintf (stderr, "Error computing distances");
+      exit (-1);
+    }
+  // Sinon le segment garderait une référence de trop
+  if (b.tables_shared)
+    {
+      shared_board = &b;
+      atexit (release_shared_board);
+    }
+
+  // Initialize game
+  game g;
+  game_create (&g, &b);
+  g.cops.size = b.cops;
+  g.robbers.size = b.robbers;
   g.r = atoi (argv[2]);
-  g.remaining_turn = g.b.max_turn + 2;
+  g.remaining_turn = b.max_turn + 2;
 
   // Play each turn
   enum role turn = COPS;
   while (game_capture_robbers (&g) != 0 && g.remaining_turn != 0)
     {
-      if (g.remaining_turn > g.b.max_turn)
+      if (g.remaining_turn > b.max_turn)
         fprintf (stderr, "Initial positions for %s\n",
                  turn == COPS ? "cops" : "robbers");
       else
@@ -933,14 +1061,14 @@ int main (int argc, const char *argv[])
         {
           // This is the turn of this program to find new positions
           vector *pos = game_next_position (&g);
-          vector_print (pos);
+          vector_print (pos, &b);
         }
       else
         {
           // This is the turn of the adversary program to find new
           // positions
           size_t len = g.r == COPS ? g.robbers.size : g.cops.size;
-          size_t *pos = read_positions (len);
+          size_t *pos = read_positions (len, &b);
           game_update_position (&g, pos);
           free (pos);
         }
@@ -953,5 +1081,26 @@ int main (int argc, const char *argv[])
     fprintf (stderr, "Robbers win!\n");
   else
     fprintf (stderr, "Cops win!\n");
+  if (b.row_cache)
+    fprintf (stderr, "Distance cache: %zu rows, %zu hits, %zu misses "
+             "(%.1f%% hit rate)\n", b.row_cache->rows, b.row_cache->hits,
+             b.row_cache->misses, 100.0 * b.row_cache->hits
+             / (b.row_cache->hits + b.row_cache->misses
+                ? b.row_cache->hits + b.row_cache->misses : 1));
+  if (b.landmarks)
+    fprintf (stderr, "Landmarks: %zu, %zu queries bounded, %zu searched\n",
+             b.landmarks->count, b.landmarks->bounded,
+             b.landmarks->searches);
+  if (b.hierarchy)
+    fprintf (stderr, "Hierarchy: %zu shortcuts, %zu queries, %.1f settled "
+             "per query\n", b.hierarchy->shortcuts, b.hierarchy->queries,
+             (double) b.hierarchy->settled
+             / (b.hierarchy->queries ? b.hierarchy->queries : 1));
+  if (b.block_tree)
+    fprintf (stderr, "Blocks: %zu, largest %zu vertices, %zu tree "
+             "components\n", b.block_tree->nblocks, b.block_tree->largest,
+             b.block_tree->trees);
   game_destroy (&g);
+  shared_board = NULL;
+  board_destroy (&b);
 }
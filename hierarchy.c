@@ -0,0 +1,750 @@
+#define _DEFAULT_SOURCE
+#include "hierarchy.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * Vertices a witness search settles at most when contracting, and when
+ * only estimating the shortcuts a contraction would add; when it gives
+ * up, the shortcut counts as needed
+ */
+#define HIERARCHY_SETTLE_LIMIT 128
+#define HIERARCHY_ESTIMATE_LIMIT 8
+
+/*
+ * Independent sets of at least HIERARCHY_PARALLEL_MIN vertices are
+ * contracted on at most HIERARCHY_THREADS threads
+ */
+#define HIERARCHY_THREADS 16
+#define HIERARCHY_PARALLEL_MIN 256
+
+#define HIERARCHY_MAGIC "CRDH"
+#define HIERARCHY_VERSION 1
+
+typedef struct
+{
+  char magic[4];
+  uint32_t version;
+  uint64_t hash;
+  uint64_t size;
+  uint64_t nedges;
+  uint64_t shortcuts;
+} hierarchy_header;
+
+enum
+{ REMAINING, SELECTED, CONTRACTED };
+
+/*
+ * Edges of a vertex towards the vertices not contracted yet, then its
+ * upward edges once it is contracted
+ */
+typedef struct
+{
+  hierarchy_edge *edges;
+  uint32_t len;
+  uint32_t capacity;
+} edge_list;
+
+/*
+ * Shortcut from vertex from, added when edge.middle is contracted
+ */
+typedef struct
+{
+  uint32_t from;
+  hierarchy_edge edge;
+} shortcut;
+
+/*
+ * Scratch of one thread: its witness search, dist being INT_MAX between
+ * searches, and the shortcuts it found
+ */
+typedef struct
+{
+  unsigned int *dist;
+  uint32_t *reached;
+  size_t nreached;
+  uint64_t *heap;
+  size_t heap_capacity;
+  shortcut *found;
+  size_t nfound;
+  size_t found_capacity;
+} worker;
+
+/*
+ * Vertices of work are contracted, or only have their priority
+ * updated, by the workers
+ */
+typedef struct
+{
+  edge_list *graph;
+  uint8_t *state;
+  int *priority;
+  uint32_t *deleted;
+  const uint32_t *work;
+  size_t nwork;
+  bool contract;
+} contraction;
+
+typedef struct
+{
+  contraction *c;
+  worker *w;
+  size_t index;
+  size_t step;
+  bool ok;
+} contraction_task;
+
+static void heap_push (uint64_t *heap, size_t *len, uint64_t key)
+{
+  size_t i = (*len)++;
+  for (; i > 0 && heap[(i - 1) / 2] > key; i = (i - 1) / 2)
+    heap[i] = heap[(i - 1) / 2];
+  heap[i] = key;
+}
+
+static uint64_t heap_pop (uint64_t *heap, size_t *len)
+{
+  uint64_t top = heap[0], last = heap[--(*len)];
+  size_t i = 0;
+  for (size_t c; (c = 2 * i + 1) < *len; i = c)
+    {
+      if (c + 1 < *len && heap[c + 1] < heap[c])
+        c++;
+      if (last <= heap[c])
+        break;
+      heap[i] = heap[c];
+    }
+  heap[i] = last;
+  return top;
+}
+
+/*
+ * Add an edge, or shorten the one already leading to the same vertex
+ */
+static bool edge_list_add (edge_list *list, hierarchy_edge edge)
+{
+  for (size_t i = 0; i < list->len; i++)
+    if (list->edges[i].to == edge.to)
+      {
+        if (edge.length < list->edges[i].length)
+          list->edges[i] = edge;
+        return true;
+      }
+  if (list->len == list->capacity)
+    {
+      size_t capacity = list->capacity ? 2 * list->capacity : 4;
+      hierarchy_edge *edges = realloc (list->edges,
+                                       capacity * sizeof (*edges));
+      if (!edges)
+        return false;
+      list->edges = edges;
+      list->capacity = capacity;
+    }
+  list->edges[list->len++] = edge;
+  return true;
+}
+
+static void edge_list_remove (edge_list *list, uint32_t to)
+{
+  for (size_t i = 0; i < list->len; i++)
+    if (list->edges[i].to == to)
+      {
+        list->edges[i] = list->edges[--list->len];
+        return;
+      }
+}
+
+/*
+ * Dijkstra search from source among the vertices not contracted yet,
+ * middle excepted, up to max or the settle limit of the phase
+ */
+static bool witness_search (const contraction *c, worker *w,
+                            uint32_t source, uint32_t middle,
+                            unsigned int max)
+{
+  size_t len = 0, settled = 0;
+  size_t limit = c->contract ? HIERARCHY_SETTLE_LIMIT
+    : HIERARCHY_ESTIMATE_LIMIT;
+  w->dist[source] = 0;
+  w->reached[w->nreached++] = source;
+  heap_push (w->heap, &len, source);
+  while (len > 0 && settled < limit)
+    {
+      uint64_t top = heap_pop (w->heap, &len);
+      uint32_t u = top, d = top >> 32;
+      if (d > w->dist[u])
+        continue;
+      if (d > max)
+        break;
+      settled++;
+      const edge_list *list = &c->graph[u];
+      for (size_t i = 0; i < list->len; i++)
+        {
+          uint32_t v = list->edges[i].to;
+          unsigned int through = d + list->edges[i].length;
+          if (v == middle || c->state[v] != REMAINING
+              || through >= w->dist[v])
+            continue;
+          if (w->dist[v] == INT_MAX)
+            w->reached[w->nreached++] = v;
+          w->dist[v] = through;
+          if (len == w->heap_capacity)
+            {
+              uint64_t *heap = realloc (w->heap, 2 * w->heap_capacity
+                                        * sizeof (*heap));
+              if (!heap)
+                return false;
+              w->heap = heap;
+              w->heap_capacity *= 2;
+            }
+          heap_push (w->heap, &len, (uint64_t) through << 32 | v);
+        }
+    }
+  return true;
+}
+
+/*
+ * Shortcuts needed to contract v: for every pair of its neighbors u, x,
+ * the path u - v - x unless the witness search from u finds another one
+ * as short. Count them in count, and keep them when contracting.
+ */
+static bool contract_vertex (const contraction *c, worker *w, uint32_t v,
+                             size_t *count)
+{
+  const edge_list *list = &c->graph[v];
+  *count = 0;
+  for (size_t i = 0; i + 1 < list->len; i++)
+    {
+      hierarchy_edge in = list->edges[i];
+      unsigned int max = 0;
+      for (size_t j = i + 1; j < list->len; j++)
+        if (in.length + list->edges[j].length > max)
+          max = in.length + list->edges[j].length;
+      w->nreached = 0;
+      if (!witness_search (c, w, in.to, v, max))
+        return false;
+      for (size_t j = i + 1; j < list->len; j++)
+        {
+          hierarchy_edge out = list->edges[j];
+          unsigned int through = in.length + out.length;
+          if (w->dist[out.to] <= through)
+            continue;
+          (*count)++;
+          if (!c->contract)
+            continue;
+          if (w->nfound == w->found_capacity)
+            {
+              size_t capacity = w->found_capacity ? 2 * w->found_capacity
+                : 64;
+              shortcut *found = realloc (w->found,
+                                         capacity * sizeof (*found));
+              if (!found)
+                return false;
+              w->found = found;
+              w->found_capacity = capacity;
+            }
+          shortcut *found = &w->found[w->nfound++];
+          found->from = in.to;
+          found->edge.to = out.to;
+          found->edge.length = through;
+          found->edge.middle = v;
+        }
+      for (size_t k = 0; k < w->nreached; k++)
+        w->dist[w->reached[k]] = INT_MAX;
+    }
+  return true;
+}
+
+/*
+ * Edge difference of v, plus its neighbors already contracted so that
+ * the contraction spreads evenly over the graph
+ */
+static bool update_priority (const contraction *c, worker *w, uint32_t v)
+{
+  size_t count;
+  if (!contract_vertex (c, w, v, &count))
+    return false;
+  c->priority[v] = (int) count - (int) c->graph[v].len + c->deleted[v];
+  return true;
+}
+
+static void *contraction_work (void *arg)
+{
+  contraction_task *task = arg;
+  const contraction *c = task->c;
+  for (size_t k = task->index; task->ok && k < c->nwork; k += task->step)
+    {
+      size_t count;
+      task->ok = c->contract ? contract_vertex (c, task->w, c->work[k],
+                                                &count)
+        : update_priority (c, task->w, c->work[k]);
+    }
+  return NULL;
+}
+
+/*
+ * Process the vertices of work on the workers, the calling thread
+ * being the first one
+ */
+static bool contraction_phase (contraction *c, worker *workers,
+                               size_t nworkers)
+{
+  size_t nthreads = c->nwork < HIERARCHY_PARALLEL_MIN ? 1 : nworkers;
+  contraction_task tasks[HIERARCHY_THREADS];
+  pthread_t threads[HIERARCHY_THREADS];
+  size_t started = 1;
+  for (size_t t = 0; t < nthreads; t++)
+    {
+      tasks[t].c = c;
+      tasks[t].w = &workers[t];
+      tasks[t].index = t;
+      tasks[t].step = nthreads;
+      tasks[t].ok = true;
+    }
+  for (; started < nthreads; started++)
+    if (pthread_create (&threads[started], NULL, contraction_work,
+                        &tasks[started]) != 0)
+      break;
+  // Les tâches non démarrées sont faites ici
+  for (size_t t = started; t < nthreads; t++)
+    contraction_work (&tasks[t]);
+  contraction_work (&tasks[0]);
+  bool ok = true;
+  for (size_t t = 1; t < started; t++)
+    pthread_join (threads[t], NULL);
+  for (size_t t = 0; t < nthreads; t++)
+    ok = ok && tasks[t].ok;
+  return ok;
+}
+
+/*
+ * v goes before u in the contraction: smaller priority, ties broken by
+ * a hash of the indices rather than the indices themselves
+ */
+static bool contracted_before (const int *priority, uint32_t v, uint32_t u)
+{
+  if (priority[v] != priority[u])
+    return priority[v] < priority[u];
+  uint32_t hv = v * 2654435761u, hu = u * 2654435761u;
+  return hv != hu ? hv < hu : v < u;
+}
+
+static bool hierarchy_scratch (hierarchy *self)
+{
+  size_t n = self->size, capacity = self->offsets[n] + 1;
+  self->dist = malloc (2 * n * sizeof (*self->dist));
+  self->parent = malloc (2 * n * sizeof (*self->parent));
+  self->reached = malloc (2 * n * sizeof (*self->reached));
+  self->heap = malloc (2 * capacity * sizeof (*self->heap));
+  if (!self->dist || !self->parent || !self->reached || !self->heap)
+    return false;
+  for (size_t v = 0; v < 2 * n; v++)
+    self->dist[v] = INT_MAX;
+  return true;
+}
+
+static void hierarchy_init (hierarchy *self)
+{
+  memset (self, 0, sizeof (*self));
+}
+
+/*
+ * Gather the upward edges of the vertices in a single allocation
+ */
+static bool hierarchy_gather (hierarchy *self, const edge_list *graph)
+{
+  size_t n = self->size, total = 0;
+  for (size_t v = 0; v < n; v++)
+    total += graph[v].len;
+  if (total >= UINT32_MAX)
+    return false;
+  self->offsets = malloc ((n + 1) * sizeof (*self->offsets)
+                          + total * sizeof (*self->edges));
+  if (!self->offsets)
+    return false;
+  self->edges = (hierarchy_edge *) (self->offsets + n + 1);
+  self->offsets[0] = 0;
+  for (size_t v = 0; v < n; v++)
+    {
+      // Sommet sans arête montante : sa liste n'a jamais été allouée
+      if (graph[v].len > 0)
+        memcpy (self->edges + self->offsets[v], graph[v].edges,
+                graph[v].len * sizeof (*self->edges));
+      self->offsets[v + 1] = self->offsets[v] + graph[v].len;
+      for (size_t i = 0; i < graph[v].len; i++)
+        self->shortcuts += graph[v].edges[i].middle != UINT32_MAX;
+    }
+  return true;
+}
+
+bool hierarchy_build (hierarchy *self, const board *b)
+{
+  if (!self || !b || !b->offsets || b->size == 0 || b->size >= UINT32_MAX)
+    return false;
+  hierarchy_init (self);
+  size_t n = b->size;
+  self->size = n;
+  long cpus = sysconf (_SC_NPROCESSORS_ONLN);
+  size_t nworkers = cpus < 1 ? 1 : (size_t) cpus < HIERARCHY_THREADS
+    ? (size_t) cpus : HIERARCHY_THREADS;
+  contraction c;
+  memset (&c, 0, sizeof (c));
+  worker *workers = calloc (nworkers, sizeof (*workers));
+  c.graph = calloc (n, sizeof (*c.graph));
+  c.state = calloc (n, sizeof (*c.state));
+  c.priority = malloc (n * sizeof (*c.priority));
+  c.deleted = calloc (n, sizeof (*c.deleted));
+  uint32_t *work = malloc (2 * n * sizeof (*work)), *touched = work + n;
+  bool *dirty = calloc (n, sizeof (*dirty));
+  bool ok = workers && c.graph && c.state && c.priority && c.deleted
+    && work && dirty;
+  for (size_t t = 0; ok && t < nworkers; t++)
+    {
+      worker *w = &workers[t];
+      w->dist = malloc (n * sizeof (*w->dist));
+      w->reached = malloc (n * sizeof (*w->reached));
+      w->heap_capacity = 64;
+      w->heap = malloc (w->heap_capacity * sizeof (*w->heap));
+      ok = w->dist && w->reached && w->heap;
+      for (size_t v = 0; ok && v < n; v++)
+        w->dist[v] = INT_MAX;
+    }
+
+  // Arêtes du plateau, sans boucles, la plus courte des arêtes multiples
+  for (size_t v = 0; ok && v < n; v++)
+    {
+      const uint32_t *neighbors = board_neighbors (b, v);
+      for (size_t i = 0; ok && i < board_degree (b, v); i++)
+        {
+          hierarchy_edge edge;
+          edge.to = neighbors[i];
+          edge.length = b->weights ? b->weights[b->offsets[v] + i] : 1;
+          edge.middle = UINT32_MAX;
+          ok = edge.to == v || edge_list_add (&c.graph[v], edge);
+        }
+    }
+  for (size_t v = 0; v < n; v++)
+    work[v] = v;
+  c.work = work;
+  c.nwork = n;
+  ok = ok && contraction_phase (&c, workers, nworkers);
+
+  size_t remaining = n;
+  while (ok && remaining > 0)
+    {
+      // Ensemble indépendant : les sommets qui passent avant tous leurs
+      // voisins restants
+      c.nwork = 0;
+      for (size_t v = 0; v < n; v++)
+        {
+          if (c.state[v] != REMAINING)
+            continue;
+          bool first = true;
+          for (size_t i = 0; first && i < c.graph[v].len; i++)
+            first = contracted_before (c.priority, v, c.graph[v].edges[i].to);
+          if (first)
+            work[c.nwork++] = v;
+        }
+      for (size_t k = 0; k < c.nwork; k++)
+        c.state[work[k]] = SELECTED;
+      for (size_t t = 0; t < nworkers; t++)
+        workers[t].nfound = 0;
+      c.contract = true;
+      if (!(ok = contraction_phase (&c, workers, nworkers)))
+        break;
+
+      // Les arêtes restantes de v deviennent ses arêtes montantes
+      size_t ntouched = 0;
+      for (size_t k = 0; k < c.nwork; k++)
+        {
+          uint32_t v = work[k];
+          c.state[v] = CONTRACTED;
+          for (size_t i = 0; i < c.graph[v].len; i++)
+            {
+              uint32_t u = c.graph[v].edges[i].to;
+              edge_list_remove (&c.graph[u], v);
+              c.deleted[u]++;
+              if (!dirty[u])
+                touched[ntouched++] = u;
+              dirty[u] = true;
+            }
+        }
+      for (size_t t = 0; ok && t < nworkers; t++)
+        for (size_t k = 0; ok && k < workers[t].nfound; k++)
+          {
+            shortcut s = workers[t].found[k];
+            hierarchy_edge back = s.edge;
+            back.to = s.from;
+            ok = edge_list_add (&c.graph[s.from], s.edge)
+              && edge_list_add (&c.graph[s.edge.to], back);
+          }
+      for (size_t k = 0; k < ntouched; k++)
+        dirty[touched[k]] = false;
+      remaining -= c.nwork;
+      c.work = touched;
+      c.nwork = ntouched;
+      c.contract = false;
+      ok = ok && contraction_phase (&c, workers, nworkers);
+      c.work = work;
+    }
+
+  ok = ok && hierarchy_gather (self, c.graph) && hierarchy_scratch (self);
+  for (size_t t = 0; workers && t < nworkers; t++)
+    {
+      free (workers[t].dist);
+      free (workers[t].reached);
+      free (workers[t].heap);
+      free (workers[t].found);
+    }
+  for (size_t v = 0; c.graph && v < n; v++)
+    free (c.graph[v].edges);
+  free (workers);
+  free (c.graph);
+  free (c.state);
+  free (c.priority);
+  free (c.deleted);
+  free (work);
+  free (dirty);
+  if (!ok)
+    hierarchy_destroy (self);
+  return ok;
+}
+
+bool hierarchy_write (const hierarchy *self, const board *b, FILE *file)
+{
+  if (!self || !self->offsets || !b || !file || b->size != self->size)
+    return false;
+  hierarchy_header header;
+  memset (&header, 0, sizeof (header));
+  memcpy (header.magic, HIERARCHY_MAGIC, sizeof (header.magic));
+  header.version = HIERARCHY_VERSION;
+  header.hash = board_hash (b);
+  header.size = self->size;
+  header.nedges = self->offsets[self->size];
+  header.shortcuts = self->shortcuts;
+  return fwrite (&header, sizeof (header), 1, file) == 1
+    && fwrite (self->offsets, sizeof (*self->offsets), self->size + 1,
+               file) == self->size + 1
+    && fwrite (self->edges, sizeof (*self->edges), header.nedges,
+               file) == header.nedges;
+}
+
+bool hierarchy_read (hierarchy *self, const board *b, const char *filename)
+{
+  if (!self || !b || !b->offsets || !filename)
+    return false;
+  int fd = open (filename, O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  hierarchy_header header;
+  if (fstat (fd, &st) != 0 || (size_t) st.st_size < sizeof (header)
+      || read (fd, &header, sizeof (header)) != sizeof (header)
+      || memcmp (header.magic, HIERARCHY_MAGIC, sizeof (header.magic))
+      || header.version != HIERARCHY_VERSION || header.size != b->size
+      || header.hash != board_hash (b) || header.nedges >= UINT32_MAX
+      || (uint64_t) st.st_size != sizeof (header)
+      + (header.size + 1) * sizeof (uint32_t)
+      + header.nedges * sizeof (hierarchy_edge))
+    {
+      close (fd);
+      return false;
+    }
+  void *data = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (data == MAP_FAILED)
+    return false;
+
+  // Un fichier abîmé ne doit pas faire sortir les recherches du tableau
+  uint32_t *offsets = (uint32_t *) ((char *) data + sizeof (header));
+  hierarchy_edge *edges = (hierarchy_edge *) (offsets + header.size + 1);
+  bool valid = offsets[0] == 0 && offsets[header.size] == header.nedges;
+  for (size_t v = 0; valid && v < header.size; v++)
+    valid = offsets[v] <= offsets[v + 1];
+  for (size_t e = 0; valid && e < header.nedges; e++)
+    valid = edges[e].to < header.size
+      && (edges[e].middle == UINT32_MAX || edges[e].middle < header.size);
+  if (!valid)
+    {
+      munmap (data, st.st_size);
+      return false;
+    }
+  hierarchy_init (self);
+  self->size = header.size;
+  self->offsets = offsets;
+  self->edges = edges;
+  self->shortcuts = header.shortcuts;
+  self->map = data;
+  self->map_len = st.st_size;
+  if (!hierarchy_scratch (self))
+    {
+      hierarchy_destroy (self);
+      return false;
+    }
+  return true;
+}
+
+void hierarchy_destroy (hierarchy *self)
+{
+  if (!self)
+    return;
+  if (self->map)
+    munmap (self->map, self->map_len);
+  else
+    free (self->offsets);
+  free (self->dist);
+  free (self->parent);
+  free (self->reached);
+  free (self->heap);
+  hierarchy_init (self);
+}
+
+/*
+ * Vertex whose upward edges include edge e
+ */
+static uint32_t edge_owner (const hierarchy *self, size_t e)
+{
+  size_t low = 0, high = self->size;
+  while (low + 1 < high)
+    {
+      size_t mid = (low + high) / 2;
+      if (self->offsets[mid] <= e)
+        low = mid;
+      else
+        high = mid;
+    }
+  while (self->offsets[low + 1] <= e)
+    low++;
+  return low;
+}
+
+/*
+ * First vertex after a on the path of the board that the edge from a to
+ * b stands for: a shortcut through middle begins with the edge from a
+ * to middle, which middle holds since it was contracted first
+ */
+static uint32_t unpack_first (const hierarchy *self, uint32_t a, uint32_t b,
+                              uint32_t middle)
+{
+  while (middle != UINT32_MAX)
+    {
+      const hierarchy_edge *edge = self->edges + self->offsets[middle];
+      const hierarchy_edge *end = self->edges + self->offsets[middle + 1];
+      while (edge < end && edge->to != a)
+        edge++;
+      if (edge == end)
+        return INT_MAX;
+      b = middle;
+      middle = edge->middle;
+    }
+  return b;
+}
+
+/*
+ * Neighbor of source on the path found through meet: the upward edge
+ * leaving source on the side of source, or the one reaching it from
+ * below on the side of dest when source is the top of the path
+ */
+static size_t first_hop (const hierarchy *self, uint32_t source,
+                         uint32_t meet)
+{
+  const uint32_t *forward = self->parent, *backward = self->parent
+    + self->size;
+  if (meet == source)
+    {
+      uint32_t e = backward[source];
+      return unpack_first (self, source, edge_owner (self, e),
+                           self->edges[e].middle);
+    }
+  uint32_t top = meet, e = forward[top];
+  for (uint32_t from; (from = edge_owner (self, e)) != source;)
+    {
+      top = from;
+      e = forward[top];
+    }
+  return unpack_first (self, source, top, self->edges[e].middle);
+}
+
+size_t hierarchy_dist (hierarchy *self, size_t source, size_t dest,
+                       size_t *next)
+{
+  if (!self || !self->offsets || source >= self->size
+      || dest >= self->size)
+    return INT_MAX;
+  if (source == dest)
+    {
+      if (next)
+        *next = source;
+      return 0;
+    }
+  self->queries++;
+  size_t n = self->size, capacity = self->offsets[n] + 1;
+  unsigned int *dist[2] = { self->dist, self->dist + n };
+  uint32_t *parent[2] = { self->parent, self->parent + n };
+  uint32_t *reached[2] = { self->reached, self->reached + n };
+  uint64_t *heap[2] = { self->heap, self->heap + capacity };
+  size_t len[2] = { 1, 1 }, count[2] = { 1, 1 };
+  uint32_t ends[2] = { source, dest };
+  for (int s = 0; s < 2; s++)
+    {
+      dist[s][ends[s]] = 0;
+      reached[s][0] = ends[s];
+      heap[s][0] = ends[s];
+    }
+
+  // Chaque côté monte tant que sa plus petite clé peut encore battre
+  // le meilleur chemin trouvé
+  size_t best = INT_MAX;
+  uint32_t meet = UINT32_MAX;
+  for (;;)
+    {
+      bool open[2];
+      for (int s = 0; s < 2; s++)
+        open[s] = len[s] > 0 && heap[s][0] >> 32 < best;
+      if (!open[0] && !open[1])
+        break;
+      int s = !open[0] || (open[1] && heap[1][0] < heap[0][0]);
+      uint64_t top = heap_pop (heap[s], &len[s]);
+      uint32_t u = top, d = top >> 32;
+      if (d > dist[s][u])
+        continue;
+      self->settled++;
+      if (dist[!s][u] != INT_MAX && (size_t) d + dist[!s][u] < best)
+        {
+          best = (size_t) d + dist[!s][u];
+          meet = u;
+        }
+      const hierarchy_edge *edge = self->edges + self->offsets[u];
+      const hierarchy_edge *end = self->edges + self->offsets[u + 1];
+      // Arrêt à la demande : atteint plus court depuis un sommet plus
+      // haut, u n'est sur aucun plus court chemin montant
+      bool stalled = false;
+      for (const hierarchy_edge *e = edge; !stalled && e < end; e++)
+        stalled = dist[s][e->to] != INT_MAX
+          && dist[s][e->to] + e->length < d;
+      for (const hierarchy_edge *e = edge; !stalled && e < end; e++)
+        {
+          unsigned int through = d + e->length;
+          if (through >= dist[s][e->to])
+            continue;
+          if (dist[s][e->to] == INT_MAX)
+            reached[s][count[s]++] = e->to;
+          dist[s][e->to] = through;
+          parent[s][e->to] = e - self->edges;
+          heap_push (heap[s], &len[s], (uint64_t) through << 32 | e->to);
+        }
+    }
+  if (next)
+    *next = meet == UINT32_MAX ? INT_MAX : first_hop (self, source, meet);
+  for (int s = 0; s < 2; s++)
+    for (size_t i = 0; i < count[s]; i++)
+      dist[s][reached[s][i]] = INT_MAX;
+  return best;
+}
@@ -0,0 +1,85 @@
+#ifndef HIERARCHY_H
+#define HIERARCHY_H
+
+#include "algo.h"
+
+/*
+ * Edge of the search graph: to is the other end, of higher rank, and
+ * middle the vertex the edge shortcuts, UINT32_MAX for an edge of the
+ * board
+ */
+typedef struct
+{
+  uint32_t to;
+  uint32_t length;
+  uint32_t middle;
+} hierarchy_edge;
+
+/*
+ * Contraction hierarchy of a board: the vertices are contracted one
+ * independent set after the other, cheapest edge difference first, and
+ * every shortest path through a contracted vertex between two of its
+ * remaining neighbors is kept as a shortcut. The edges of vertex v
+ * towards the vertices contracted after it are
+ * edges[offsets[v]] .. edges[offsets[v + 1] - 1]; as the board is
+ * undirected, the same upward graph serves the searches from both ends
+ * of a query. shortcuts counts the edges that are not edges of the
+ * board.
+ *
+ * dist, parent and reached are the scratch arrays of the queries, two
+ * halves of size entries each, and heap their two heaps; queries and
+ * settled count the queries and the vertices they settled. offsets and
+ * edges share a single allocation owned by offsets, or point into map
+ * when the hierarchy comes from a file.
+ */
+typedef struct hierarchy
+{
+  size_t size;
+  uint32_t *offsets;
+  hierarchy_edge *edges;
+  size_t shortcuts;
+  void *map;
+  size_t map_len;
+  unsigned int *dist;
+  uint32_t *parent;
+  uint32_t *reached;
+  uint64_t *heap;
+  size_t queries;
+  size_t settled;
+} hierarchy;
+
+/*
+ * Contract the vertices of a board, the witness searches of each
+ * independent set running on several threads, and return false if
+ * memory is missing
+ */
+bool hierarchy_build (hierarchy * self, const board * b);
+
+/*
+ * Write the search graph after a header holding the hash of the board
+ * it was built for. Return false on error.
+ */
+bool hierarchy_write (const hierarchy * self, const board * b, FILE * file);
+
+/*
+ * Map a file written by hierarchy_write. Return false if it cannot be
+ * read or was written for another graph.
+ */
+bool hierarchy_read (hierarchy * self, const board * b,
+                     const char *filename);
+
+/*
+ * Destroy a hierarchy by freeing all memory used by its members
+ */
+void hierarchy_destroy (hierarchy * self);
+
+/*
+ * Length of a shortest path between source and dest, INT_MAX if they
+ * are not connected, by a search upwards from each end. If next is not
+ * NULL store there the neighbor of source on such a path, source
+ * itself if source == dest, found by unpacking the shortcuts.
+ */
+size_t hierarchy_dist (hierarchy * self, size_t source, size_t dest,
+                       size_t *next);
+
+#endif // HIERARCHY_H
@@ -0,0 +1,413 @@
+#include "kernel.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+  uint64_t hash;
+  uint32_t degree;
+  uint32_t vertex;
+} twin_key;
+
+static int compare_uint32 (const void *a, const void *b)
+{
+  uint32_t x = *(const uint32_t *) a, y = *(const uint32_t *) b;
+  return (x > y) - (x < y);
+}
+
+static int compare_twin_key (const void *a, const void *b)
+{
+  const twin_key *x = a, *y = b;
+  if (x->hash != y->hash)
+    return x->hash < y->hash ? -1 : 1;
+  if (x->degree != y->degree)
+    return x->degree < y->degree ? -1 : 1;
+  return (x->vertex > y->vertex) - (x->vertex < y->vertex);
+}
+
+static uint64_t mix (uint64_t x)
+{
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+/*
+ * Closed neighborhoods of u and w are equal: u and w are adjacent and
+ * their other neighbors are the same (rows sorted without self-loops)
+ */
+static bool true_twins (const uint32_t *off, const uint32_t *nb,
+                        uint32_t u, uint32_t w)
+{
+  const uint32_t *a = nb + off[u], *a_end = nb + off[u + 1];
+  const uint32_t *b = nb + off[w], *b_end = nb + off[w + 1];
+  if (!bsearch (&w, a, a_end - a, sizeof (*a), compare_uint32))
+    return false;
+  while (true)
+    {
+      if (a < a_end && *a == w)
+        a++;
+      if (b < b_end && *b == u)
+        b++;
+      if (a == a_end || b == b_end)
+        return a == a_end && b == b_end;
+      if (*a++ != *b++)
+        return false;
+    }
+}
+
+/*
+ * Follow the chain leaving anchor `from` through neighbor x until the
+ * next anchor, which is returned. The interior vertices are written to
+ * buf and their number to *len
+ */
+static uint32_t walk_chain (const uint32_t *off, const uint32_t *nb,
+                            const bool *anchor, uint32_t from, uint32_t x,
+                            uint32_t *buf, size_t *len)
+{
+  uint32_t prev = from, cur = x;
+  *len = 0;
+  while (!anchor[cur])
+    {
+      buf[(*len)++] = cur;
+      uint32_t next = nb[off[cur]] == prev ? nb[off[cur] + 1] : nb[off[cur]];
+      prev = cur;
+      cur = next;
+    }
+  return cur;
+}
+
+static void kernel_init (kernel *self)
+{
+  memset (self, 0, sizeof (*self));
+}
+
+void kernel_destroy (kernel *self)
+{
+  if (!self)
+    return;
+  free (self->offsets);
+  free (self->adj);
+  free (self->path);
+  free (self->path_ends);
+  free (self->length);
+  free (self->path_start);
+  free (self->members);
+  free (self->kind);
+  free (self->image);
+  free (self->position);
+  free (self->original);
+  kernel_init (self);
+}
+
+bool kernel_build (kernel *self, const board *b)
+{
+  if (!self)
+    return false;
+  kernel_init (self);
+  if (!b || !b->offsets)
+    return false;
+  size_t n = b->size, m = b->offsets[n];
+
+  uint32_t *off = malloc ((n + 1) * sizeof (*off));
+  uint32_t *nb = malloc ((m + 1) * sizeof (*nb));
+  uint32_t *off1 = malloc ((n + 1) * sizeof (*off1));
+  uint32_t *nb1 = malloc ((m + 1) * sizeof (*nb1));
+  uint32_t *rep = malloc ((n + 1) * sizeof (*rep));
+  uint32_t *buf = malloc ((n + 1) * sizeof (*buf));
+  twin_key *keys = malloc ((n + 1) * sizeof (*keys));
+  bool *anchor = calloc (n + 1, sizeof (*anchor));
+  bool *seen = calloc (n + 1, sizeof (*seen));
+  self->kind = malloc ((n + 1) * sizeof (*self->kind));
+  self->image = malloc ((n + 1) * sizeof (*self->image));
+  self->position = calloc (n + 1, sizeof (*self->position));
+  self->members = malloc ((n + 1) * sizeof (*self->members));
+  bool ok = off && nb && off1 && nb1 && rep && buf && keys && anchor
+    && seen && self->kind && self->image && self->position
+    && self->members;
+  if (!ok)
+    goto end;
+
+  // Lignes triées sans doublons ni boucles
+  off[0] = 0;
+  for (size_t v = 0; v < n; v++)
+    {
+      uint32_t *row = nb + off[v];
+      size_t len = 0;
+      memcpy (row, board_neighbors (b, v),
+              board_degree (b, v) * sizeof (*row));
+      qsort (row, board_degree (b, v), sizeof (*row), compare_uint32);
+      for (size_t i = 0; i < board_degree (b, v); i++)
+        if (row[i] != v && (len == 0 || row[len - 1] != row[i]))
+          row[len++] = row[i];
+      off[v + 1] = off[v] + len;
+    }
+
+  // Jumeaux : même empreinte du voisinage fermé, puis comparaison exacte
+  for (size_t v = 0; v < n; v++)
+    {
+      uint64_t hash = mix (v);
+      for (size_t i = off[v]; i < off[v + 1]; i++)
+        hash += mix (nb[i]);
+      keys[v].hash = hash;
+      keys[v].degree = off[v + 1] - off[v];
+      keys[v].vertex = v;
+      rep[v] = UINT32_MAX;
+    }
+  qsort (keys, n, sizeof (*keys), compare_twin_key);
+  for (size_t i = 0; i < n;)
+    {
+      size_t j = i;
+      while (j < n && keys[j].hash == keys[i].hash
+             && keys[j].degree == keys[i].degree)
+        j++;
+      for (size_t k = i; k < j; k++)
+        {
+          uint32_t u = keys[k].vertex;
+          if (rep[u] != UINT32_MAX)
+            continue;
+          rep[u] = u;
+          for (size_t l = k + 1; l < j; l++)
+            if (rep[keys[l].vertex] == UINT32_MAX
+                && true_twins (off, nb, u, keys[l].vertex))
+              {
+                rep[keys[l].vertex] = u;
+                self->twins++;
+              }
+        }
+      i = j;
+    }
+
+  // Graphe quotient sur les représentants
+  off1[0] = 0;
+  for (size_t v = 0; v < n; v++)
+    {
+      uint32_t *row = nb1 + off1[v];
+      size_t len = 0;
+      if (rep[v] == v)
+        {
+          for (size_t i = off[v]; i < off[v + 1]; i++)
+            if (rep[nb[i]] != v)
+              row[len++] = rep[nb[i]];
+          qsort (row, len, sizeof (*row), compare_uint32);
+          size_t kept = 0;
+          for (size_t i = 0; i < len; i++)
+            if (kept == 0 || row[kept - 1] != row[i])
+              row[kept++] = row[i];
+          len = kept;
+          anchor[v] = len != 2 && off[v + 1] > off[v];
+        }
+      off1[v + 1] = off1[v] + len;
+    }
+
+  // Une boucle pendue à un sommet garde son milieu, un cycle isolé
+  // garde son plus petit sommet et le sommet opposé
+  for (size_t r = 0; r < n; r++)
+    for (size_t i = off1[r]; anchor[r] && i < off1[r + 1]; i++)
+      {
+        size_t len;
+        if (anchor[nb1[i]] || seen[nb1[i]])
+          continue;
+        uint32_t end = walk_chain (off1, nb1, anchor, r, nb1[i], buf, &len);
+        for (size_t k = 0; k < len; k++)
+          seen[buf[k]] = true;
+        if (end == r)
+          anchor[buf[len / 2]] = true;
+      }
+  for (size_t v = 0; v < n; v++)
+    {
+      if (rep[v] != v || anchor[v] || seen[v] || off1[v + 1] == off1[v])
+        continue;
+      size_t len = 0;
+      uint32_t prev = v, cur = nb1[off1[v]];
+      buf[len++] = v;
+      while (cur != v)
+        {
+          buf[len++] = cur;
+          uint32_t next =
+            nb1[off1[cur]] == prev ? nb1[off1[cur] + 1] : nb1[off1[cur]];
+          prev = cur;
+          cur = next;
+        }
+      for (size_t k = 0; k < len; k++)
+        seen[buf[k]] = true;
+      // v est le plus petit sommet du cycle, rencontré en premier
+      anchor[v] = true;
+      anchor[buf[len / 2]] = true;
+    }
+
+  // Numérotation des sommets du noyau
+  for (size_t v = 0; v < n; v++)
+    {
+      if (off[v + 1] == off[v])
+        {
+          self->kind[v] = KERNEL_ISOLATED;
+          self->image[v] = UINT32_MAX;
+          self->isolated++;
+        }
+      else if (rep[v] != v)
+        {
+          self->kind[v] = KERNEL_TWIN;
+          self->image[v] = rep[v];
+        }
+      else if (anchor[v])
+        {
+          self->kind[v] = KERNEL_VERTEX;
+          self->image[v] = self->size++;
+        }
+      else
+        {
+          self->kind[v] = KERNEL_CHAIN;
+          self->chained++;
+        }
+    }
+
+  // Chemins entre sommets du noyau, enregistrés depuis leur plus
+  // petite extrémité ; il y en a au plus un par arête du quotient
+  size_t max_paths = off1[n] / 2 + 1;
+  self->path_ends = malloc (2 * max_paths * sizeof (*self->path_ends));
+  self->length = malloc (max_paths * sizeof (*self->length));
+  self->path_start = malloc ((max_paths + 1) * sizeof (*self->path_start));
+  self->original = malloc ((self->size + 1) * sizeof (*self->original));
+  self->offsets = calloc (self->size + 1, sizeof (*self->offsets));
+  if (!self->path_ends || !self->length || !self->path_start
+      || !self->original || !self->offsets)
+    {
+      ok = false;
+      goto end;
+    }
+  size_t cursor = 0;
+  for (size_t r = 0; r < n; r++)
+    {
+      if (self->kind[r] != KERNEL_VERTEX)
+        continue;
+      self->original[self->image[r]] = r;
+      for (size_t i = off1[r]; i < off1[r + 1]; i++)
+        {
+          size_t len, p = self->npaths;
+          uint32_t end = walk_chain (off1, nb1, anchor, r, nb1[i], buf,
+                                     &len);
+          if (end < r)
+            continue;
+          self->path_ends[2 * p] = self->image[r];
+          self->path_ends[2 * p + 1] = self->image[end];
+          self->length[p] = len + 1;
+          self->path_start[p] = cursor;
+          for (size_t k = 0; k < len; k++)
+            {
+              self->members[cursor + k] = buf[k];
+              self->image[buf[k]] = p;
+              self->position[buf[k]] = k + 1;
+            }
+          cursor += len;
+          self->npaths++;
+        }
+    }
+  self->path_start[self->npaths] = cursor;
+
+  // CSR pondéré du noyau, chaque chemin apparaissant à ses deux bouts
+  for (size_t p = 0; p < self->npaths; p++)
+    {
+      self->offsets[self->path_ends[2 * p] + 1]++;
+      self->offsets[self->path_ends[2 * p + 1] + 1]++;
+    }
+  for (size_t k = 0; k < self->size; k++)
+    self->offsets[k + 1] += self->offsets[k];
+  size_t edges = self->offsets[self->size];
+  self->adj = malloc ((edges + 1) * sizeof (*self->adj));
+  self->path = malloc ((edges + 1) * sizeof (*self->path));
+  if (!self->adj || !self->path)
+    {
+      ok = false;
+      goto end;
+    }
+  memcpy (buf, self->offsets, self->size * sizeof (*buf));
+  for (size_t p = 0; p < self->npaths; p++)
+    for (size_t side = 0; side < 2; side++)
+      {
+        uint32_t from = self->path_ends[2 * p + side];
+        self->adj[buf[from]] = self->path_ends[2 * p + 1 - side];
+        self->path[buf[from]++] = p;
+      }
+
+end:
+  free (off);
+  free (nb);
+  free (off1);
+  free (nb1);
+  free (rep);
+  free (buf);
+  free (keys);
+  free (anchor);
+  free (seen);
+  if (!ok)
+    kernel_destroy (self);
+  return ok;
+}
+
+size_t kernel_dist (const kernel *self, size_t source, size_t dest)
+{
+  if (!self || source >= self->size || dest >= self->size)
+    return INT_MAX;
+  // Dijkstra avec un tas binaire à suppression paresseuse
+  size_t cap = self->offsets[self->size] + 1;
+  size_t *dist = malloc (self->size * sizeof (*dist));
+  uint64_t *heap = malloc (cap * sizeof (*heap));
+  size_t result = INT_MAX;
+  if (!dist || !heap)
+    goto end;
+  for (size_t k = 0; k < self->size; k++)
+    dist[k] = INT_MAX;
+  dist[source] = 0;
+  size_t len = 0;
+  heap[len++] = source;
+  while (len > 0)
+    {
+      uint64_t top = heap[0];
+      heap[0] = heap[--len];
+      for (size_t i = 0; 2 * i + 1 < len;)
+        {
+          size_t c = 2 * i + 1;
+          if (c + 1 < len && heap[c + 1] < heap[c])
+            c++;
+          if (heap[i] <= heap[c])
+            break;
+          uint64_t tmp = heap[i];
+          heap[i] = heap[c];
+          heap[c] = tmp;
+          i = c;
+        }
+      size_t u = top & UINT32_MAX, d = top >> 32;
+      if (d > dist[u])
+        continue;
+      if (u == dest)
+        {
+          result = d;
+          break;
+        }
+      for (size_t e = self->offsets[u]; e < self->offsets[u + 1]; e++)
+        {
+          size_t v = self->adj[e], nd = d + self->length[self->path[e]];
+          if (nd >= dist[v])
+            continue;
+          dist[v] = nd;
+          // Chaque arête entre au plus une fois dans le tas
+          size_t i = len++;
+          heap[i] = (uint64_t) nd << 32 | v;
+          while (i > 0 && heap[(i - 1) / 2] > heap[i])
+            {
+              uint64_t tmp = heap[i];
+              heap[i] = heap[(i - 1) / 2];
+              heap[(i - 1) / 2] = tmp;
+              i = (i - 1) / 2;
+            }
+        }
+    }
+end:
+  free (dist);
+  free (heap);
+  return result;
+}
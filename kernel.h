@@ -0,0 +1,68 @@
+#ifndef KERNEL_H
+#define KERNEL_H
+
+#include "algo.h"
+
+/*
+ * What became of a vertex of the board in the kernel
+ */
+enum kernel_kind
+{ KERNEL_VERTEX, KERNEL_TWIN, KERNEL_ISOLATED, KERNEL_CHAIN };
+
+/*
+ * Reduced graph of a board: isolated vertices are stripped, true twins
+ * (same closed neighborhood) are merged into the smallest of them, and
+ * every maximal path whose interior vertices have degree 2 becomes a
+ * single edge weighted by its number of edges. A cycle made only of
+ * degree-2 vertices keeps two opposite vertices joined by two edges.
+ *
+ * The kernel is a weighted multigraph in CSR form: the edges of kernel
+ * vertex k are offsets[k] .. offsets[k + 1] - 1, edge e leading to
+ * adj[e] along path path[e]. Path p goes from kernel vertex
+ * path_ends[2p] to path_ends[2p + 1] in length[p] edges, its interior
+ * board vertices being members[path_start[p]] .. in order.
+ *
+ * For board vertex v, kind[v] tells what happened to it and image[v]
+ * is its kernel vertex (KERNEL_VERTEX), the board vertex it was merged
+ * into (KERNEL_TWIN), its path (KERNEL_CHAIN, v being at position[v]
+ * edges from the first end), or UINT32_MAX (KERNEL_ISOLATED).
+ * original[k] is the board vertex kept for kernel vertex k. Lengths
+ * count edges: the weights of a weighted board are not looked at.
+ */
+typedef struct
+{
+  size_t size;
+  uint32_t *offsets;
+  uint32_t *adj;
+  uint32_t *path;
+  size_t npaths;
+  uint32_t *path_ends;
+  uint32_t *length;
+  uint32_t *path_start;
+  uint32_t *members;
+  uint8_t *kind;
+  uint32_t *image;
+  uint32_t *position;
+  uint32_t *original;
+  size_t isolated;
+  size_t twins;
+  size_t chained;
+} kernel;
+
+/*
+ * Build the kernel of a board and return false if memory is missing
+ */
+bool kernel_build (kernel * self, const board * b);
+
+/*
+ * Destroy a kernel by freeing all memory used by its members
+ */
+void kernel_destroy (kernel * self);
+
+/*
+ * Return the weight of the shortest path between kernel vertices
+ * source and dest, or INT_MAX if they are not connected
+ */
+size_t kernel_dist (const kernel * self, size_t source, size_t dest);
+
+#endif // KERNEL_H
@@ -18,6 +18,10 @@ python_cmd=python3
 verbose=false                    
 ############################
 
+# Tables de distances calculées une fois par carte puis relues par ./game
+export GAME_DIST_CACHE="${GAME_DIST_CACHE:-.dist_cache}"
+mkdir -p "$GAME_DIST_CACHE"
+
 
 
 args=("$@")  # convertit en tableau pour accéder avec un index
@@ -0,0 +1,469 @@
+#include "symmetry.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+  uint32_t color;
+  uint32_t vertex;
+  uint64_t hash;
+} refine_key;
+
+/*
+ * The first path of the search individualizes base[0], base[1], ... in
+ * turn: path[j] is the colouring after the first j of them, with
+ * ncolors[j] colours, and path[depth] is discrete. The generators found
+ * while working on level j fix base[0] .. base[j - 1].
+ */
+typedef struct
+{
+  const board *b;
+  size_t n;
+  refine_key *keys;
+  uint32_t **path;
+  size_t *ncolors;
+  uint32_t *base;
+  size_t depth;
+  uint32_t *scratch;
+  uint32_t *count_left;
+  uint32_t *count_right;
+  symmetry *out;
+  size_t max_nodes;
+  size_t nodes;
+  bool failed;
+} search;
+
+static int compare_refine_key (const void *a, const void *b)
+{
+  const refine_key *x = a, *y = b;
+  if (x->color != y->color)
+    return x->color < y->color ? -1 : 1;
+  if (x->hash != y->hash)
+    return x->hash < y->hash ? -1 : 1;
+  return (x->vertex > y->vertex) - (x->vertex < y->vertex);
+}
+
+static uint64_t mix (uint64_t x)
+{
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+/*
+ * Split the colour classes by the colours of the neighbors until
+ * nothing changes, and return the number of colours. The new colours
+ * only depend on the old ones and on the graph, so two colourings
+ * exchanged by an automorphism stay exchanged.
+ */
+static size_t refine (search *s, uint32_t *color)
+{
+  size_t ncolors = 0;
+  while (true)
+    {
+      for (size_t v = 0; v < s->n; v++)
+        {
+          uint64_t hash = 0;
+          const uint32_t *neighbors = board_neighbors (s->b, v);
+          for (size_t i = 0; i < board_degree (s->b, v); i++)
+            hash += mix (color[neighbors[i]]);
+          s->keys[v].color = color[v];
+          s->keys[v].vertex = v;
+          s->keys[v].hash = hash;
+        }
+      qsort (s->keys, s->n, sizeof (*s->keys), compare_refine_key);
+      size_t next = 0;
+      for (size_t i = 0; i < s->n; i++)
+        {
+          if (i > 0 && (s->keys[i].color != s->keys[i - 1].color
+                        || s->keys[i].hash != s->keys[i - 1].hash))
+            next++;
+          color[s->keys[i].vertex] = next;
+        }
+      next++;
+      if (next == ncolors)
+        return ncolors;
+      ncolors = next;
+    }
+}
+
+/*
+ * Give v a colour of its own and refine
+ */
+static size_t individualize (search *s, const uint32_t *color, uint32_t v,
+                             uint32_t *out)
+{
+  for (size_t u = 0; u < s->n; u++)
+    out[u] = 2 * color[u] + (u == v);
+  return refine (s, out);
+}
+
+/*
+ * Whether a colouring has the class sizes of path[j], counted in
+ * count_left beforehand
+ */
+static bool same_shape (search *s, const uint32_t *color, size_t ncolors,
+                        size_t j)
+{
+  if (ncolors != s->ncolors[j])
+    return false;
+  memset (s->count_right, 0, ncolors * sizeof (*s->count_right));
+  for (size_t v = 0; v < s->n; v++)
+    s->count_right[color[v]]++;
+  return memcmp (s->count_left, s->count_right,
+                 ncolors * sizeof (*s->count_left)) == 0;
+}
+
+static void count_classes (search *s, size_t j)
+{
+  memset (s->count_left, 0, s->ncolors[j] * sizeof (*s->count_left));
+  for (size_t v = 0; v < s->n; v++)
+    s->count_left[s->path[j][v]]++;
+}
+
+/*
+ * Record as a generator the permutation matching equal colours of
+ * path[depth] and of a discrete colouring if it preserves adjacency
+ */
+static bool search_leaf (search *s, const uint32_t *right)
+{
+  size_t n = s->n;
+  const uint32_t *left = s->path[s->depth];
+  for (size_t w = 0; w < n; w++)
+    s->scratch[right[w]] = w;
+  for (size_t v = 0; v < n; v++)
+    {
+      uint32_t image = s->scratch[left[v]];
+      const uint32_t *neighbors = board_neighbors (s->b, v);
+      if (board_degree (s->b, image) != board_degree (s->b, v))
+        return false;
+      for (size_t i = 0; i < board_degree (s->b, v); i++)
+        if (!board_is_valid_move (s->b, image,
+                                  s->scratch[left[neighbors[i]]]))
+          return false;
+    }
+  symmetry *out = s->out;
+  uint32_t *gens = realloc (out->gens, (out->ngens + 1) * n * sizeof (*gens));
+  if (!gens)
+    {
+      s->failed = true;
+      return false;
+    }
+  out->gens = gens;
+  uint32_t *perm = gens + out->ngens * n;
+  for (size_t v = 0; v < n; v++)
+    perm[v] = s->scratch[left[v]];
+  out->ngens++;
+  return true;
+}
+
+/*
+ * right is a colouring with the class sizes of path[j], reached by
+ * individualizing candidate images of base[0] .. base[j - 1]. Look for
+ * one automorphism among the leaves below it and return whether one
+ * was found.
+ */
+static bool search_node (search *s, const uint32_t *right, size_t j)
+{
+  if (j == s->depth)
+    return search_leaf (s, right);
+  uint32_t *next = malloc (s->n * sizeof (*next));
+  if (!next)
+    {
+      s->failed = true;
+      return false;
+    }
+  uint32_t cell = s->path[j][s->base[j]];
+  bool found = false;
+  for (uint32_t w = 0; w < s->n && !found; w++)
+    {
+      if (right[w] != cell)
+        continue;
+      if (s->failed || s->nodes++ >= s->max_nodes)
+        {
+          s->out->complete = false;
+          break;
+        }
+      size_t ncolors = individualize (s, right, w, next);
+      count_classes (s, j + 1);
+      if (same_shape (s, next, ncolors, j + 1))
+        found = search_node (s, next, j + 1);
+    }
+  free (next);
+  return found;
+}
+
+/*
+ * Mark the orbit of v under all the generators found so far, which
+ * are the ones fixing the base vertices above the current level, and
+ * return its size
+ */
+static size_t mark_orbit (search *s, uint32_t v, bool *in_orbit)
+{
+  symmetry *out = s->out;
+  memset (in_orbit, 0, s->n * sizeof (*in_orbit));
+  in_orbit[v] = true;
+  s->scratch[0] = v;
+  size_t len = 1;
+  for (size_t i = 0; i < len; i++)
+    for (size_t k = 0; k < out->ngens; k++)
+      {
+        uint32_t w = out->gens[k * s->n + s->scratch[i]];
+        if (!in_orbit[w])
+          {
+            in_orbit[w] = true;
+            s->scratch[len++] = w;
+          }
+      }
+  return len;
+}
+
+/*
+ * Follow the first path down to a discrete colouring, always fixing the
+ * smallest vertex of the first class of more than one vertex
+ */
+static bool first_path (search *s)
+{
+  size_t n = s->n;
+  s->path = calloc (n + 1, sizeof (*s->path));
+  s->ncolors = malloc ((n + 1) * sizeof (*s->ncolors));
+  s->base = malloc ((n + 1) * sizeof (*s->base));
+  if (!s->path || !s->ncolors || !s->base)
+    return false;
+  s->depth = 0;
+  s->path[0] = calloc (n, sizeof (**s->path));
+  if (!s->path[0])
+    return false;
+  s->ncolors[0] = refine (s, s->path[0]);
+  while (s->ncolors[s->depth] < n)
+    {
+      size_t j = s->depth;
+      count_classes (s, j);
+      uint32_t cell = 0;
+      while (s->count_left[cell] < 2)
+        cell++;
+      uint32_t base = 0;
+      while (s->path[j][base] != cell)
+        base++;
+      s->base[j] = base;
+      s->path[j + 1] = malloc (n * sizeof (**s->path));
+      if (!s->path[j + 1])
+        return false;
+      s->depth++;
+      s->ncolors[j + 1] = individualize (s, s->path[j], base, s->path[j + 1]);
+      s->nodes++;
+    }
+  return true;
+}
+
+bool symmetry_compute (symmetry *self, const board *b, size_t max_nodes)
+{
+  if (!self)
+    return false;
+  self->size = 0;
+  self->ngens = 0;
+  self->gens = NULL;
+  self->order = 0;
+  self->complete = true;
+  if (!b || !b->offsets)
+    return false;
+
+  search s;
+  memset (&s, 0, sizeof (s));
+  s.b = b;
+  s.n = b->size;
+  s.out = self;
+  s.max_nodes = max_nodes;
+  s.keys = malloc (b->size * sizeof (*s.keys));
+  s.scratch = malloc (b->size * sizeof (*s.scratch));
+  s.count_left = malloc (b->size * sizeof (*s.count_left));
+  s.count_right = malloc (b->size * sizeof (*s.count_right));
+  bool *in_orbit = malloc (b->size * sizeof (*in_orbit));
+  uint32_t *right = malloc (b->size * sizeof (*right));
+  if (!s.keys || !s.scratch || !s.count_left || !s.count_right || !in_orbit
+      || !right || !first_path (&s))
+    s.failed = true;
+  self->size = b->size;
+  self->order = 1;
+
+  // Du niveau le plus profond vers la racine, chaque image de base[j]
+  // hors de l'orbite déjà connue est essayée une fois
+  for (size_t j = s.depth; j-- > 0 && !s.failed && self->complete;)
+    {
+      uint32_t base = s.base[j];
+      uint32_t cell = s.path[j][base];
+      size_t orbit = mark_orbit (&s, base, in_orbit);
+      for (uint32_t w = 0; w < s.n && !s.failed && self->complete; w++)
+        {
+          if (s.path[j][w] != cell || in_orbit[w])
+            continue;
+          if (s.nodes++ >= s.max_nodes)
+            {
+              self->complete = false;
+              break;
+            }
+          size_t ncolors = individualize (&s, s.path[j], w, right);
+          count_classes (&s, j + 1);
+          if (same_shape (&s, right, ncolors, j + 1)
+              && search_node (&s, right, j + 1))
+            orbit = mark_orbit (&s, base, in_orbit);
+        }
+      // L'ordre est le produit des tailles des orbites successives
+      self->order = self->order > SIZE_MAX / orbit ? SIZE_MAX
+        : self->order * orbit;
+    }
+
+  free (s.keys);
+  free (s.scratch);
+  free (s.count_left);
+  free (s.count_right);
+  free (in_orbit);
+  free (right);
+  if (s.path)
+    for (size_t j = 0; j <= s.depth; j++)
+      free (s.path[j]);
+  free (s.path);
+  free (s.ncolors);
+  free (s.base);
+  if (s.failed)
+    symmetry_destroy (self);
+  return !s.failed;
+}
+
+void symmetry_destroy (symmetry *self)
+{
+  if (!self)
+    return;
+  free (self->gens);
+  self->gens = NULL;
+  self->ngens = 0;
+  self->size = 0;
+  self->order = 0;
+}
+
+static void sort_small (uint32_t *tab, size_t n)
+{
+  for (size_t i = 1; i < n; i++)
+    {
+      uint32_t x = tab[i];
+      size_t j = i;
+      for (; j > 0 && tab[j - 1] > x; j--)
+        tab[j] = tab[j - 1];
+      tab[j] = x;
+    }
+}
+
+static int compare_position (const uint32_t *a, const uint32_t *b, size_t len)
+{
+  for (size_t i = 0; i < len; i++)
+    if (a[i] != b[i])
+      return a[i] < b[i] ? -1 : 1;
+  return 0;
+}
+
+static uint64_t hash_position (const uint32_t *pos, size_t len)
+{
+  uint64_t hash = len;
+  for (size_t i = 0; i < len; i++)
+    hash = mix (hash ^ pos[i]);
+  return hash;
+}
+
+/*
+ * Hash table of the first count positions of seen, each of len values,
+ * holding their index plus one in slots slots, a power of two
+ */
+static uint32_t *index_positions (const uint32_t *seen, size_t count,
+                                  size_t len, size_t slots)
+{
+  uint32_t *table = calloc (slots, sizeof (*table));
+  for (size_t i = 0; table && i < count; i++)
+    {
+      size_t slot = hash_position (seen + i * len, len) & (slots - 1);
+      while (table[slot])
+        slot = (slot + 1) & (slots - 1);
+      table[slot] = i + 1;
+    }
+  return table;
+}
+
+bool symmetry_canonicalize (const symmetry *self, uint32_t *cops,
+                            size_t ncops, uint32_t *robbers,
+                            size_t nrobbers)
+{
+  if (!self || !self->complete || self->size == 0)
+    return false;
+  size_t len = ncops + nrobbers, width = len ? len : 1;
+  // Les images déjà vues, dans l'ordre de découverte, plus une place
+  // pour la suivante, et leur table de hachage, remplie au plus à
+  // moitié, qui contient leur indice plus un ; les deux doublent avec
+  // l'orbite pour que les petites orbites restent bon marché
+  size_t capacity = 16, slots = 2 * capacity;
+  uint32_t *seen = malloc ((capacity + 1) * width * sizeof (*seen));
+  if (!seen)
+    return false;
+  for (size_t i = 0; i < len; i++)
+    seen[i] = i < ncops ? cops[i] : robbers[i - ncops];
+  sort_small (seen, ncops);
+  sort_small (seen + ncops, nrobbers);
+  uint32_t *table = index_positions (seen, 1, len, slots);
+  size_t count = 1, best = 0;
+  bool ok = table != NULL;
+  for (size_t q = 0; q < count && ok; q++)
+    for (size_t k = 0; k < self->ngens && ok; k++)
+      {
+        if (count == capacity && capacity < SYMMETRY_ORBIT_MAX)
+          {
+            uint32_t *grown = realloc (seen, (2 * capacity + 1) * width
+                                       * sizeof (*seen));
+            if (!grown)
+              {
+                ok = false;
+                break;
+              }
+            seen = grown;
+            capacity *= 2;
+          }
+        const uint32_t *perm = self->gens + k * self->size;
+        uint32_t *image = seen + count * len;
+        for (size_t i = 0; i < len; i++)
+          {
+            uint32_t v = seen[q * len + i];
+            image[i] = v < self->size ? perm[v] : v;
+          }
+        sort_small (image, ncops);
+        sort_small (image + ncops, nrobbers);
+        size_t slot = hash_position (image, len) & (slots - 1);
+        while (table[slot]
+               && memcmp (seen + (table[slot] - 1) * len, image,
+                          len * sizeof (*image)) != 0)
+          slot = (slot + 1) & (slots - 1);
+        if (table[slot])
+          continue;
+        if (count == SYMMETRY_ORBIT_MAX)
+          {
+            ok = false;
+            break;
+          }
+        table[slot] = ++count;
+        if (compare_position (image, seen + best * len, len) < 0)
+          best = count - 1;
+        if (2 * count > slots)
+          {
+            free (table);
+            slots *= 2;
+            table = index_positions (seen, count, len, slots);
+            ok = table != NULL;
+          }
+      }
+  for (size_t i = 0; ok && i < len; i++)
+    if (i < ncops)
+      cops[i] = seen[best * len + i];
+    else
+      robbers[i - ncops] = seen[best * len + i];
+  free (seen);
+  free (table);
+  return ok;
+}
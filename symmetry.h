@@ -0,0 +1,57 @@
+#ifndef SYMMETRY_H
+#define SYMMETRY_H
+
+#include "algo.h"
+
+/*
+ * Automorphisms of a board, the permutations of its vertices that
+ * preserve adjacency (edge weights are ignored), kept as a generating
+ * set: generator k maps vertex v to gens[k * size + v]. order is the
+ * number of automorphisms, SIZE_MAX if it does not fit. complete is
+ * false when the search ran out of nodes: the generators then only
+ * span part of the group and order is a lower bound.
+ */
+typedef struct
+{
+  size_t size;
+  size_t ngens;
+  uint32_t *gens;
+  size_t order;
+  bool complete;
+} symmetry;
+
+/*
+ * Find generators of the automorphism group of a board by colour
+ * refinement and individualization, skipping the images already
+ * reached by the generators found, in at most max_nodes refinements.
+ * Return false if memory is missing.
+ */
+bool symmetry_compute (symmetry * self, const board * b, size_t max_nodes);
+
+/*
+ * Destroy a group by freeing all memory used by its members
+ */
+void symmetry_destroy (symmetry * self);
+
+/*
+ * Replace a position by the smallest of its images under the group:
+ * both sets are sorted and the cops, then the robbers, compared
+ * lexicographically. Indices that are not vertices (NO_VERTEX for
+ * tokens not placed yet) are left as they are. The images are
+ * enumerated from the generators, so the cost grows with the number of
+ * distinct images of the position, not with the order of the group.
+ * Return false, the position being left as it is, if the group is not
+ * complete, if the position has more than SYMMETRY_ORBIT_MAX images or
+ * if memory is missing.
+ */
+bool symmetry_canonicalize (const symmetry * self, uint32_t * cops,
+                            size_t ncops, uint32_t * robbers,
+                            size_t nrobbers);
+
+/*
+ * Largest number of images of a position that symmetry_canonicalize
+ * enumerates
+ */
+#define SYMMETRY_ORBIT_MAX 65536
+
+#endif // SYMMETRY_H